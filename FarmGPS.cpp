@@ -19,77 +19,367 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "FarmGPS.h"
+#include "GeoReference.h"
+#include <stddef.h>
+
+//---------------
+// sentence schema
+//---------------
+
+// A sentence maps its terms to field decoders and to the fix members they are
+// committed to. Parsing another sentence adds a table entry in flash, a case
+// for its formatter in parse_sentence_id(), and to the fix only the members it
+// maintains
+
+// milliseconds per day, for the clock fit around midnight
+#define GPS_DAY_MS 86400000L
+
+#define GPS_SLOT(member) offsetof(GpsFix, member)
+#define GPS_FIELDS(fields) sizeof fields / sizeof fields[0], fields
+
+// decoders used by the configured sentences, the others are compiled out
+#if defined(GPGGA_TERM) || defined(GPRMC_TERM)
+#define GPS_DECODE_DEGREES
+#define GPS_DECODE_TIME
+#endif
+#if defined(GPGGA_TERM) || defined(PTNL_PJK_TERM)
+#define GPS_DECODE_INTEGER
+#endif
+
+#ifdef GPGGA_TERM
+const FarmGPS::Field FarmGPS::gga_fields[] PROGMEM = {
+  { 1, TIME, GPS_SLOT(time), 0, GPS_GGA_TIME },
+  { 2, DEGREES, GPS_SLOT(latitude), 1, GPS_GGA_POSITION },
+  { 3, HEMISPHERE, 0, 1, GPS_GGA_POSITION },
+  { 4, DEGREES, GPS_SLOT(longitude), 2, GPS_GGA_POSITION },
+  { 5, HEMISPHERE, 0, 2, GPS_GGA_POSITION },
+  { 6, INTEGER, GPS_SLOT(quality), 3, GPS_GGA_QUALITY },
+  { 9, DECIMAL, GPS_SLOT(altitude), 4, GPS_GGA_ALTITUDE }
+};
+#endif
+
+#ifdef GPVTG_TERM
+const FarmGPS::Field FarmGPS::vtg_fields[] PROGMEM = {
+  { 1, DECIMAL, GPS_SLOT(course), 0, GPS_VTG_COURSE },
+  { 5, DECIMAL, GPS_SLOT(speed), 1, GPS_VTG_SPEED }
+};
+#endif
+
+#ifdef GPXTE_TERM
+const FarmGPS::Field FarmGPS::xte_fields[] PROGMEM = {
+  { 3, DECIMAL, GPS_SLOT(xte), 0, GPS_XTE_DISTANCE }
+};
+#endif
+
+#ifdef ROXTE_TERM
+const FarmGPS::Field FarmGPS::roxte_fields[] PROGMEM = {
+  { 1, DECIMAL, GPS_SLOT(xte), 0, GPS_XTE_DISTANCE }
+};
+#endif
+
+#ifdef GPGST_TERM
+const FarmGPS::Field FarmGPS::gst_fields[] PROGMEM = {
+  { 2, DECIMAL, GPS_SLOT(rms), 0, GPS_GST_ACCURACY },
+  { 6, DECIMAL, GPS_SLOT(latitude_error), 1, GPS_GST_ACCURACY },
+  { 7, DECIMAL, GPS_SLOT(longitude_error), 2, GPS_GST_ACCURACY },
+  { 8, DECIMAL, GPS_SLOT(altitude_error), 3, GPS_GST_ACCURACY }
+};
+#endif
+
+#ifdef GPRMC_TERM
+const FarmGPS::Field FarmGPS::rmc_fields[] PROGMEM = {
+  { 1, TIME, GPS_SLOT(time), 0, GPS_RMC_TIME },
+  { 2, STATUS, 0, 0, GPS_RMC_TIME | GPS_RMC_POSITION | GPS_RMC_MOTION },
+  { 3, DEGREES, GPS_SLOT(latitude), 1, GPS_RMC_POSITION },
+  { 4, HEMISPHERE, 0, 1, GPS_RMC_POSITION },
+  { 5, DEGREES, GPS_SLOT(longitude), 2, GPS_RMC_POSITION },
+  { 6, HEMISPHERE, 0, 2, GPS_RMC_POSITION },
+  { 7, DECIMAL, GPS_SLOT(speed), 3, GPS_RMC_MOTION },
+  { 8, DECIMAL, GPS_SLOT(course), 4, GPS_RMC_MOTION },
+  { 9, DATE, GPS_SLOT(date), 5, GPS_RMC_TIME }
+};
+#endif
+
+#ifdef GPHDT_TERM
+const FarmGPS::Field FarmGPS::hdt_fields[] PROGMEM = {
+  { 1, DECIMAL, GPS_SLOT(heading), 0, GPS_HDT_HEADING }
+};
+#endif
+
+#ifdef PTNL_PJK_TERM
+const FarmGPS::Field FarmGPS::pjk_fields[] PROGMEM = {
+  { 4, CENTIMETERS, GPS_SLOT(northing), 0, GPS_PJK_POSITION },
+  { 6, CENTIMETERS, GPS_SLOT(easting), 1, GPS_PJK_POSITION },
+  { 8, INTEGER, GPS_SLOT(grid_quality), 2, GPS_PJK_POSITION },
+  { 11, DECIMAL, GPS_SLOT(grid_height), 3, GPS_PJK_POSITION }
+};
+#endif
+
+// Sentences by type, parse_sentence_id() matches their formatters, types that
+// are compiled out keep an empty entry
+#define GPS_NO_SCHEMA { 0, 0, 0, 0 }
+
+const FarmGPS::Sentence FarmGPS::sentences[] PROGMEM = {
+#ifdef GPGGA_TERM
+  { GPS_SENTENCE_GGA, GPS_SLOT(last_GGA_fix), GPS_FIELDS(gga_fields) },    // ??GGA
+#else
+  GPS_NO_SCHEMA,
+#endif
+#ifdef GPVTG_TERM
+  { GPS_SENTENCE_VTG, GPS_SLOT(last_VTG_fix), GPS_FIELDS(vtg_fields) },    // ??VTG
+#else
+  GPS_NO_SCHEMA,
+#endif
+#ifdef GPXTE_TERM
+  { GPS_SENTENCE_XTE, GPS_SLOT(last_XTE_fix), GPS_FIELDS(xte_fields) },    // ??XTE
+#else
+  GPS_NO_SCHEMA,
+#endif
+#ifdef ROXTE_TERM
+  { GPS_SENTENCE_XTE, GPS_SLOT(last_XTE_fix), GPS_FIELDS(roxte_fields) },  // ROXTE
+#else
+  GPS_NO_SCHEMA,
+#endif
+#ifdef GPGST_TERM
+  { GPS_SENTENCE_GST, GPS_SLOT(last_GST_fix), GPS_FIELDS(gst_fields) },    // ??GST
+#else
+  GPS_NO_SCHEMA,
+#endif
+#ifdef GPRMC_TERM
+  { GPS_SENTENCE_RMC, GPS_SLOT(last_RMC_fix), GPS_FIELDS(rmc_fields) },    // ??RMC
+#else
+  GPS_NO_SCHEMA,
+#endif
+#ifdef GPHDT_TERM
+  { GPS_SENTENCE_HDT, GPS_SLOT(last_HDT_fix), GPS_FIELDS(hdt_fields) },    // ??HDT
+#else
+  GPS_NO_SCHEMA,
+#endif
+#ifdef PTNL_PJK_TERM
+  { GPS_SENTENCE_PJK, GPS_SLOT(last_PJK_fix), GPS_FIELDS(pjk_fields) }     // PTNL,PJK
+#else
+  GPS_NO_SCHEMA
+#endif
+};
+
+// switch key of the three formatter characters of a sentence id
+#define GPS_FORMATTER(a, b, c) ((unsigned long)byte(a) << 16 | (unsigned int)byte(b) << 8 | byte(c))
 
 //------------
 // Constructor
 //------------
 
 FarmGPS::FarmGPS(){
-  time = GPS_INVALID_FLOAT;
-  date = GPS_INVALID_LONG;
-  latitude = GPS_INVALID_FLOAT;
-  longitude = GPS_INVALID_FLOAT;
-  altitude = GPS_INVALID_FLOAT;
-  speed = GPS_INVALID_FLOAT;
-  course = GPS_INVALID_FLOAT;
-  xte = GPS_INVALID_FLOAT;
-  quality = 0;
-
-  last_GGA_fix = 0;
-  last_VTG_fix = 0;
-  last_XTE_fix = 0;
+  GpsConfig _default = GPS_DEFAULT_CONFIG;
+  own_config = _default;
+  init(&own_config);
+}
+
+FarmGPS::FarmGPS(GpsConfig &_config){
+  init(&_config);
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+// Sets the decoder to its state before the first character
+void FarmGPS::init(GpsConfig *_config){
+  config = _config;
+
+  fix.time = GPS_INVALID_LONG;
+  fix.date.day = 0;
+  fix.date.month = 0;
+  fix.date.year = 0;
+  fix.latitude = GPS_INVALID_ANGLE;
+  fix.longitude = GPS_INVALID_ANGLE;
+  fix.altitude = GPS_INVALID_FLOAT;
+  fix.speed = GPS_INVALID_FLOAT;
+  fix.course = GPS_INVALID_FLOAT;
+  fix.xte = GPS_INVALID_FLOAT;
+  fix.quality = 0;
+  fix_sequence = 0;
+
+  fix.last_GGA_fix = 0;
+  fix.last_VTG_fix = 0;
+  fix.last_XTE_fix = 0;
+  fix.last_epoch = 0;
+  fix.epoch_time = GPS_INVALID_LONG;
+  fix.last_start = 0;
+#ifdef GPS_STAMP_CLOCK
+  fix.last_stamp = 0;
+#endif
+
+#ifdef GPGST_TERM
+  fix.rms = GPS_INVALID_FLOAT;
+  fix.latitude_error = GPS_INVALID_FLOAT;
+  fix.longitude_error = GPS_INVALID_FLOAT;
+  fix.altitude_error = GPS_INVALID_FLOAT;
+  fix.last_GST_fix = 0;
+#endif
+#ifdef GPRMC_TERM
+  fix.last_RMC_fix = 0;
+#endif
+#ifdef GPHDT_TERM
+  fix.heading = GPS_INVALID_FLOAT;
+  fix.last_HDT_fix = 0;
+#endif
+#ifdef PTNL_PJK_TERM
+  fix.northing = GPS_INVALID_ANGLE;
+  fix.easting = GPS_INVALID_ANGLE;
+  fix.grid_height = GPS_INVALID_FLOAT;
+  fix.grid_quality = 0;
+  fix.last_PJK_fix = 0;
+#endif
+
+  new_GGA_data = false;
+  new_VTG_data = false;
+  new_XTE_data = false;
+  new_epoch_data = false;
+
+  sentence_millis = 0;
+#ifdef GPS_STAMP_CLOCK
+  sentence_stamp = 0;
+#endif
+  given_millis = 0;
+#ifdef GPS_STAMP_CLOCK
+  given_stamp = 0;
+#endif
+  start_given = false;
+  clock_millis = 0;
+  clock_utc = GPS_INVALID_LONG;
+  clock_rate = 1;
+
+  pps_edges = 0;
+  pps_millis = 0;
+  pps_paired = 0;
+  pps_utc = GPS_INVALID_LONG;
+  pps_at = 0;
+
+  epoch_pending = 0;
+  epoch_last = 0;
+
+  velocity_north = 0;
+  velocity_east = 0;
+  velocity_speed = GPS_INVALID_FLOAT;
+  velocity_course = GPS_INVALID_FLOAT;
 
   term[0] = '\0';
   term_number = 0;
   term_offset = 0;
   parity = 0;
-  sum = 0;
-  checksum = 0;
   is_checksum_term = false;
   sentence_type = OTHER;
+  reset_number();
+
+  schema = 0;
+  schema_field = 0;
+
+#ifndef GPS_NO_TRIMBLE
+  trimble_state = TRIMBLE_IDLE;
+  trimble_length = 0;
+  trimble_sum = 0;
+#endif
+
+  term_interest = 0;
+  is_wanted_term = true;
+  forward_pending = 0;
 
 #ifndef GPS_NO_STATS
-  encoded_characters = 0;
-  good_sentences = 0;
-  failed_checksum = 0;
-  passed_checksum = 0;
+  memset(&statistics, 0, sizeof statistics);
+#endif
+
+#ifdef GPS_PROFILE
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+  // enable trace (DEMCR.TRCENA) and the DWT cycle counter (DWT_CTRL.CYCCNTENA)
+  *(volatile unsigned long *)0xE000EDFC |= 1UL << 24;
+  *(volatile unsigned long *)0xE0001000 |= 1UL;
+#endif
+  reset_profile();
 #endif
 }
 
-//----------------------------------------
-// private member functions implementation
-//----------------------------------------
+// Clears the fixed-point term value
+void FarmGPS::reset_number() {
+  term_integer = 0;
+  term_fraction = 0;
+  term_decimals = 0;
+  term_in_fraction = false;
+  term_negative = false;
+}
+
+// Adds an ascii character to the fixed-point term value
+void FarmGPS::parse_digit(char c) {
+  if (c >= '0' && c <= '9') {
+    if (!term_in_fraction) {
+      term_integer = term_integer * 10 + (c - '0');
+    }
+    else if (term_decimals < 9) {
+      // more decimals than fit in 32 bits are dropped
+      term_fraction = term_fraction * 10 + (c - '0');
+      term_decimals++;
+    }
+  }
+  else if (c == '.') {
+    term_in_fraction = true;
+  }
+  else if (c == '-') {
+    term_negative = true;
+  }
+}
+
+// Parses fixed-point term value to float
+float FarmGPS::parse_decimal() {
+  unsigned long _scale = 1;
+  for (byte i = 0; i < term_decimals; i++)
+    _scale *= 10;
 
-// Parses ascii to float
-float FarmGPS::parse_decimal(const char *s) {
-  float _f = atof(s);  //atof from stdlib.h
-  return _f;
+  float _f = term_integer + float(term_fraction) / _scale;
+  return term_negative ? -_f : _f;
 }
 
-// Parses ascii deg/min.dec to float degrees
-float FarmGPS::parse_degrees(const char *s) {
-  float _f = atof(s);  //atof from stdlib.h
+// Parses fixed-point term value deg/min.dec to degrees * 10^7 without float math
+long FarmGPS::parse_degrees() {
+  // minutes decimals scaled to 7 digits
+  unsigned long _fraction = term_fraction;
+  for (byte i = term_decimals; i > 7; i--)
+    _fraction /= 10;
+  for (byte i = term_decimals; i < 7; i++)
+    _fraction *= 10;
 
-  int _left = _f / 100;
-  float _right = _f - _left * 100;
+  long _left = term_integer / 100;
+  unsigned long _right = (term_integer % 100) * 10000000UL + _fraction;
 
-  return _left + _right / 60.0;
+  // rounded minutes to degrees
+  return _left * 10000000L + (_right + 30) / 60;
 }
 
-// Compares two strings returns true if the same
-bool FarmGPS::strcmp(const char *str1, const char *str2) {
-  while (*str1 == *str2) {
-    //check for null character
-    if (!*str1){
-      return true;
-    }
-    str1++, str2++;
-  }
-  return false;
+// Parses fixed-point term value to integer
+int FarmGPS::parse_integer() {
+  int _i = term_integer;
+  return term_negative ? -_i : _i;
+}
+
+// Parses fixed-point term value to integer scaled by decimals, e.g. meters to centimeters
+long FarmGPS::parse_fixed(byte decimals) {
+  unsigned long _fraction = term_fraction;
+  long _l = term_integer;
+  for (byte i = term_decimals; i > decimals; i--)
+    _fraction /= 10;
+  for (byte i = term_decimals; i < decimals; i++)
+    _fraction *= 10;
+  for (byte i = 0; i < decimals; i++)
+    _l *= 10;
+
+  _l += _fraction;
+  return term_negative ? -_l : _l;
 }
-int FarmGPS::parse_integer(const char*s) {
-  int _i = atoi(s);
-  return _i;
+
+// Parses fixed-point term value hhmmss.ss to centiseconds since midnight
+unsigned long FarmGPS::parse_time() {
+  unsigned long _cc = parse_fixed(2);
+  unsigned long _t = _cc / 100;
+  return ((_t / 10000) * 3600 + (_t / 100 % 100) * 60 + _t % 100) * 100 + _cc % 100;
 }
 
 // Converts hex ascii to integer
@@ -98,185 +388,434 @@ int FarmGPS::hex_to_int(char c) {
     return c - 'A' + 10;
   else if (c >= 'a' && c <= 'f')
     return c - 'a' + 10;
-  else
+  else if (c >= '0' && c <= '9')
     return c - '0';
+  else
+    return 16;
+}
+// Publishes the fields of a sentence validated by its protocol
+// Returns true, so protocol decoders can return its result
+bool FarmGPS::commit() {
+#ifndef GPS_NO_STATS
+  statistics.good_sentences++;
+  statistics.sentences[sentence_type]++;
+#endif
+  unsigned long _now = millis();
+  Sentence _s;
+  memcpy_P(&_s, &sentences[schema], sizeof _s);
+  unsigned int _sentence = _s.flag;
+
+  // odd sequence while the fix is being updated, see read_fix()
+  fix_sequence++;
+  GPS_BARRIER();
+  unsigned long _time = fix.time;
+  schema_copy(true);
+  unsigned long _stamp = pps_align(_now);
+  memcpy((byte *)&fix + _s.stamp, &_stamp, sizeof _stamp);
+  fix.last_start = sentence_millis;
+#ifdef GPS_STAMP_CLOCK
+  fix.last_stamp = sentence_stamp;
+#endif
+
+  // the first sentence of each new GPS time paces the clock fit
+  if (fix.time != _time && fix.time != GPS_INVALID_LONG)
+    clock_update(fix.time * 10, sentence_millis);
+  switch (sentence_type) {
+  case GGA:
+    new_GGA_data = true;
+    break;
+  case VTG:
+    new_VTG_data = true;
+    break;
+  case XTE:
+  case XTE2:
+    new_XTE_data = true;
+    break;
+#ifdef GPRMC_TERM
+  case RMC:
+    // the GGA position and VTG motion it updates carry its stamp
+    if (config->interest & GPS_RMC_POSITION)
+      fix.last_GGA_fix = _stamp;
+    if (config->interest & GPS_RMC_MOTION)
+      fix.last_VTG_fix = _stamp;
+    break;
+#endif
+  default:
+    break;
+  }
+
+  // A repeated sentence or a gap in the burst starts the next epoch
+  if ((epoch_pending & _sentence) || _now - epoch_last > config->epoch_gap)
+    epoch_pending = 0;
+  epoch_last = _now;
+  bool _complete = (epoch_pending & config->epoch_sentences) == config->epoch_sentences;
+  epoch_pending |= _sentence;
+  bool _epoch = !_complete && (epoch_pending & config->epoch_sentences) == config->epoch_sentences;
+  if (_epoch) {
+    fix.last_epoch = _stamp;
+    fix.epoch_time = fix.time;
+    new_epoch_data = true;
+  }
+  GPS_BARRIER();
+  fix_sequence++;
+
+  if (config->callback) {
+    config->callback(*this, _sentence, fix);
+    if (_epoch)
+      config->callback(*this, GPS_SENTENCE_EPOCH, fix);
+  }
+  return true;
+}
+
+// The first fix time on a whole second within a second after an edge pairs
+// with it, later times of the same second follow at their offset
+unsigned long FarmGPS::pps_align(unsigned long now) {
+  byte _edges;
+  unsigned long _edge;
+  do {
+    _edges = pps_edges;
+    _edge = pps_millis;
+  } while (_edges != pps_edges);
+
+  if (fix.time == GPS_INVALID_LONG)
+    return now;
+  if (_edges != pps_paired && fix.time % 100 == 0 && now - _edge < 1000) {
+    pps_paired = _edges;
+    pps_utc = fix.time;
+    pps_at = _edge;
+  }
+  if (pps_utc == GPS_INVALID_LONG || now - pps_at > GPS_PPS_HOLD)
+    return now;
+
+  long _offset = fix.time - pps_utc;
+  if (_offset < 0)
+    _offset += GPS_DAY_MS / 10;
+  if (_offset * 10 > GPS_PPS_HOLD)
+    return now;
+  return pps_at + _offset * 10;
+}
+
+// Second order loop on the sentence start, the fit takes a quarter of the error
+// and the rate a sixteenth of the rate error, which averages out the jitter of
+// the receiver output and the serial line
+void FarmGPS::clock_update(unsigned long utc, unsigned long time) {
+  if (clock_utc != GPS_INVALID_LONG) {
+    long _elapsed = time - clock_millis;
+    long _predicted = clock_utc + long(_elapsed * clock_rate);
+    long _error = long(utc) - _predicted;
+    // midnight between the fit and the new time
+    if (_error < -GPS_DAY_MS / 2)
+      _error += GPS_DAY_MS;
+    else if (_error > GPS_DAY_MS / 2)
+      _error -= GPS_DAY_MS;
+
+    if (_elapsed > 0 && _elapsed < GPS_CLOCK_HOLD && _error > -GPS_CLOCK_SLEW && _error < GPS_CLOCK_SLEW) {
+      clock_rate += float(_error) / _elapsed / 16;
+      _predicted += _error / 4;
+      if (_predicted < 0)
+        _predicted += GPS_DAY_MS;
+      clock_utc = _predicted % GPS_DAY_MS;
+      clock_millis = time;
+      return;
+    }
+  }
+  clock_utc = utc;
+  clock_millis = time;
+  clock_rate = 1;
 }
+
 // Processes a just-completed term
 // Returns true if new sentence has just passed checksum test and is validated
 bool FarmGPS::parse_term() {
   if (is_checksum_term) {
-    if (sentence_type == XTE2) {
-      //checksum already checked in feedgps() for Trimble strings...
-      checksum = parity;
-    }
-    else {
-      // Process checksum and update state
-      checksum = 16 * hex_to_int(term[0]) + hex_to_int(term[1]);
-    }
-    if (checksum == parity) {
+    // Process checksum and update state, exactly two hex digits
+    if (sentence_type >= OTHER)
+      return false;
+    int _high = hex_to_int(term[0]), _low = term_offset == 2 ? hex_to_int(term[1]) : 16;
+    if (_high < 16 && _low < 16 && (_high << 4 | _low) == parity)
+      return commit();
 #ifndef GPS_NO_STATS
-      good_sentences++;
-#endif
-      switch (sentence_type) {
-      case GGA:
-        altitude = new_altitude;
-        time = new_time;
-        latitude = new_latitude;
-        longitude = new_longitude;
-        quality = new_quality;
-        last_GGA_fix = millis();
-        new_GGA_data = true;
+    statistics.failed_checksum++;
+    statistics.failed[sentence_type]++;
+#endif
+    return false;
+  }
+  
+  // The first term determines the sentence type, proprietary sentences the second
+  if (term_number == 0 || sentence_type == PTNL) {
+    parse_sentence_id();
+    return false;
+  }
+
+  // Decode the term with the next field of the schema, fields are in term order
+  if (term[0]) {
+    const Field *_fields;
+    memcpy_P(&_fields, &sentences[schema].fields, sizeof _fields);
+    byte _count;
+    memcpy_P(&_count, &sentences[schema].count, 1);
+    while (schema_field < _count) {
+      Field _f;
+      memcpy_P(&_f, &_fields[schema_field], sizeof _f);
+      if (_f.term > term_number)
+        break;
+      schema_field++;
+      if (_f.term < term_number)
+        continue;
+
+      Value &_v = pending[_f.value];
+      switch (_f.decoder) {
+      case DECIMAL:
+        _v.f = parse_decimal();
         break;
-      case VTG:
-        course = new_course;
-        speed = new_speed;
-        last_VTG_fix = millis();
-        new_VTG_data = true;
+#ifdef GPS_DECODE_DEGREES
+      case DEGREES:
+        _v.l = parse_degrees();
         break;
-      case XTE:
-      case XTE2:
-        xte = new_xte;
-        last_XTE_fix = millis();
-        new_XTE_data = true;
+      case HEMISPHERE:
+        if (term[0] == 'S' || term[0] == 'W')
+          _v.l = -_v.l;
+        break;
+#endif
+#ifdef GPS_DECODE_INTEGER
+      case INTEGER:
+        _v.i = parse_integer();
+        break;
+#endif
+#ifdef GPS_DECODE_TIME
+      case TIME:
+        _v.l = parse_time();
+        break;
+#endif
+#ifdef GPRMC_TERM
+      case DATE:
+        _v.d.day = term_integer / 10000;
+        _v.d.month = term_integer / 100 % 100;
+        _v.d.year = term_integer % 100;
+        break;
+      case STATUS:
+        // void fix, skip the rest of the sentence
+        if (term[0] != 'A')
+          sentence_type = OTHER;
+        break;
+#endif
+#ifdef PTNL_PJK_TERM
+      case CENTIMETERS:
+        _v.l = parse_fixed(2);
+        break;
+#endif
+      default:
         break;
       }
-      return true;
-    }
-#ifndef GPS_NO_STATS
-    else {
-      failed_checksum++;
+      break;
     }
+  }
+  return false;
+}
+
+// Identifies the sentence by the formatter in term, any talker id matches
+void FarmGPS::parse_sentence_id() {
+  types _type = OTHER;
+  if (sentence_type == PTNL) {
+#ifdef PTNL_PJK_TERM
+    if (term_offset == 3 && term[0] == 'P' && term[1] == 'J' && term[2] == 'K')
+      _type = PJK;
 #endif
-    return false;  // no "else if" needed because of return statements
   }
-  
-  if (term_number == 0) {
-  // The first term determines the sentence type
+  else if (term_offset == 5) {
+    switch (GPS_FORMATTER(term[2], term[3], term[4])) {
 #ifdef GPGGA_TERM
-    if (strcmp(term, GPGGA_TERM))
-      sentence_type = GGA;
-    else
+    case GPS_FORMATTER('G', 'G', 'A'):
+      _type = GGA;
+      break;
 #endif
 #ifdef GPVTG_TERM
-    if (strcmp(term, GPVTG_TERM))
-      sentence_type = VTG;
-    else
+    case GPS_FORMATTER('V', 'T', 'G'):
+      _type = VTG;
+      break;
 #endif
+#if defined(GPXTE_TERM) || defined(ROXTE_TERM)
+    case GPS_FORMATTER('X', 'T', 'E'):
+      // Trimble ROXTE is not an XTE of talker RO
+      if (term[0] == 'R' && term[1] == 'O') {
+#ifdef ROXTE_TERM
+        _type = XTE2;
+#endif
+      }
+      else {
 #ifdef GPXTE_TERM
-    if (strcmp(term, GPXTE_TERM))
-      sentence_type = XTE;
-    else
+        _type = XTE;
+#endif
+      }
+      break;
+#endif
+#ifdef GPGST_TERM
+    case GPS_FORMATTER('G', 'S', 'T'):
+      _type = GST;
+      break;
 #endif
 #ifdef GPRMC_TERM
-    if (strcmp(term, GPRMC_TERM))
-      sentence_type = RMC;
-    else
+    case GPS_FORMATTER('R', 'M', 'C'):
+      _type = RMC;
+      break;
 #endif
-#ifdef ROXTE_TERM
-    if (strcmp(term, ROXTE_TERM))
-      sentence_type = XTE2;
-    else
+#ifdef GPHDT_TERM
+    case GPS_FORMATTER('H', 'D', 'T'):
+      _type = HDT;
+      break;
 #endif
-      sentence_type = OTHER;
-    return false;
+    default:
+      break;
+    }
   }
-  
-  if (term[0]){
-  // Check if char array is filled
-    switch (sentence_type) {
-    case GGA:
-      switch (term_number) {
-      case 1: //Time
-        new_time = parse_decimal(term);
-        break;
-      case 2: // Latitude
-        new_latitude = parse_degrees(term);
-        break;
-      case 3: // N/S
-        if (term[0] == 'S') {
-          new_latitude = -new_latitude;
-        }
-        break;
-      case 4: // Longitude
-        new_longitude = parse_degrees(term);
-        break;
-      case 5: // E/W
-        if (term[0] == 'W') {
-          new_longitude = -new_longitude;
-        }
-        break;
-      case 6: // Fix data quality
-        new_quality = parse_integer(term);
-        break;
-      case 9: // Altitude
-        new_altitude = parse_decimal(term);
-        break;
-      }
+#ifdef PTNL_PJK_TERM
+  else if (term_offset == 4 && term[0] == 'P' && term[1] == 'T' && term[2] == 'N' && term[3] == 'L') {
+    _type = PTNL;
+  }
+#endif
+  sentence_type = _type;
+  term_interest = 0;
+  if (sentence_type == OTHER) {
+#ifndef GPS_NO_STATS
+    statistics.unknown_sentences++;
+#endif
+    return;
+  }
+
+  // proprietary sentence, identified by the next term
+  if (sentence_type == PTNL) {
+    term_interest = 1 << 1;
+    return;
+  }
+
+  // Terms holding subscribed fields, unwanted sentences are skipped by decode()
+  Sentence _s;
+  schema = sentence_type;
+  memcpy_P(&_s, &sentences[schema], sizeof _s);
+  unsigned int interest = config->interest;
+  schema_field = 0;
+  for (byte i = 0; i < _s.count; i++) {
+    Field _f;
+    memcpy_P(&_f, &_s.fields[i], sizeof _f);
+    if (interest & _f.interest)
+      term_interest |= 1 << _f.term;
+  }
+  if (!term_interest)
+    sentence_type = OTHER;
+  else
+    // fields that are not subscribed to are committed unchanged
+    schema_copy(false);
+}
+
+// Copies the pending values of the current schema to the fix, or loads them from it
+void FarmGPS::schema_copy(bool to_fix) {
+  Sentence _s;
+  memcpy_P(&_s, &sentences[schema], sizeof _s);
+  for (byte i = 0; i < _s.count; i++) {
+    Field _f;
+    memcpy_P(&_f, &_s.fields[i], sizeof _f);
+
+    byte *_slot = (byte *)&fix + _f.slot;
+    Value &_v = pending[_f.value];
+    switch (_f.decoder) {
+    case HEMISPHERE:
+    case STATUS:
       break;
-    case VTG:
-      switch (term_number) {
-      case 1: // Course
-        new_course = parse_decimal(term);
-        break;
-      case 5: // Speed
-        new_speed = parse_decimal(term);
-        break;
-      }
+    case DECIMAL:
+      if (to_fix)
+        *(float *)_slot = _v.f;
+      else
+        _v.f = *(float *)_slot;
       break;
-    case XTE:
-      switch (term_number) {
-      case 3: // XTE
-        new_xte = parse_decimal(term);
-        break;
-      }
+    case INTEGER:
+      if (to_fix)
+        *(int *)_slot = _v.i;
+      else
+        _v.i = *(int *)_slot;
       break;
-    case XTE2:
-      switch (term_number) {
-      case 1: // Trimble XTE
-        new_xte = parse_decimal(term);
-        break;
-      }
+    case DATE:
+      if (to_fix)
+        *(GpsDate *)_slot = _v.d;
+      else
+        _v.d = *(GpsDate *)_slot;
       break;
-    case OTHER:
+    default:
+      if (to_fix)
+        *(long *)_slot = _v.l;
+      else
+        _v.l = *(long *)_slot;
       break;
     }
   }
-  return false;
 }
 
-//--------------------------------------
-//public member functions implementation
-//--------------------------------------
+//After receiving character, hand it to the decoder of its protocol
+bool FarmGPS::parse_char(char c) {
+#ifndef GPS_NO_STATS
+  statistics.encoded_characters++;
+#endif
 
-//After receiving character, start decoding sentence
-bool FarmGPS::decode(char c) {
+#ifndef GPS_NO_TRIMBLE
+  // a Trimble frame owns all bytes up to its DLE ETX
+  if (trimble_state != TRIMBLE_IDLE) {
+    start_given = false;
+    return parse_trimble(c);
+  }
+  if (byte(c) == GPS_TRIMBLE_START) {
+    start_sentence();
+    trimble_state = TRIMBLE_DATA;
+    trimble_length = 0;
+    trimble_sum = 0;
+    return false;
+  }
+#endif
+  // stamps given by set_start() only apply to the next character
+  if (c != '$' && c != '@')
+    start_given = false;
+  return parse_nmea(c);
+}
+
+// Corrupt sentences are dropped before their terms are converted, the
+// term number makes decode() skip the sentence id too
+void FarmGPS::abort_sentence() {
+#ifndef GPS_NO_STATS
+  statistics.aborted_sentences++;
+#endif
+  sentence_type = OTHER;
+  term_number = 1;
+}
+
+//NMEA decoder, split sentence into terms and check its parity
+bool FarmGPS::parse_nmea(char c) {
   //
   bool valid_sentence = false;
-  byte t = 0;
-  encoded_characters++;
+
+  // unwanted sentence, only look for the start of the next sentence
+  if (sentence_type == OTHER && term_number > 0 && c != '$' && c != '@') {
+#ifndef GPS_NO_STATS
+    statistics.skipped_characters++;
+#endif
+    return valid_sentence;
+  }
 
   //start decoding, split sentence into terms separated by ","', "/r", "/n", "*" or "$".
   switch (c) {
-// trimble id (reset sum)
-  case 191:
-    term_number = term_offset = 0;
-    sum = 0;
-    break;
 // sentence start
   case '$':
   case '@':
-    // sentence begin, reset decoding process
+    // sentence begin, reset decoding process, a Trimble frame is stamped at its start byte
+    if (!in_frame())
+      start_sentence();
     term_number = term_offset = 0;
     parity = 0;
-    sum += byte(c);
     sentence_type = OTHER;
     is_checksum_term = false;
+    is_wanted_term = true;
+    reset_number();
     break;
-// bitbucket for unwanted trimble and in NMEA unused characters
+// bitbucket for in NMEA unused characters
   case 20:
   case 0:
   case ' ':
-    sum += byte(c);
     break;
 // term terminators, decode term by term
   case ',':
@@ -285,7 +824,6 @@ bool FarmGPS::decode(char c) {
   case '*':
   case '\r':
   case '\n':
-    sum += byte(c);
     term[term_offset] = '\0';
     // pass completed term off to processing
     valid_sentence = parse_term();
@@ -293,43 +831,427 @@ bool FarmGPS::decode(char c) {
     term_number++;
     term_offset = 0;
     is_checksum_term = c == '*';
+    is_wanted_term = is_checksum_term || (term_number < 16 && (term_interest & 1 << term_number));
+    reset_number();
     break;
-// trimble specific term terminator and parity check
-// ascii 3 is terminator when preceded by ascii 16
-// last 3 digits before ascii 3 are: number of characters send
-// 2 byte hex sum of all characters after trimble id 
-  case 3:
-    if (term[term_offset - 1] == 16 && !is_checksum_term) {
-      sum -= byte(term[term_offset - 1]);
-      sum -= byte(term[term_offset - 2]);
-      sum -= byte(term[term_offset - 3]);
-    
-      // check trimble checksum
-      if (sum - byte(term[term_offset - 2]) - (256 * byte(term[term_offset - 3])) == 0) {
-        term[term_offset - 3] = '\0';
-        parse_term();
-        is_checksum_term = true;
-        valid_sentence = parse_term();
-      }
-      term_number++;
-      term_offset = 0;
-      break;
-    }
-    else {
-      // ordinary character
-    }
 // ordinary characters
   default:
-    if (term_offset < sizeof (term) - 1)
+    // a character outside printable ascii is line noise, the checksum would fail
+    if (byte(c - ' ') > '~' - ' ' && !is_checksum_term) {
+      abort_sentence();
+      break;
+    }
+    if (is_wanted_term) {
+      if (term_offset == sizeof (term) - 1) {
+#ifndef GPS_NO_STATS
+        statistics.term_overflows++;
+#endif
+        abort_sentence();
+        break;
+      }
       term[term_offset++] = c;
+      parse_digit(c);
+    }
     if (!is_checksum_term)
       parity ^= c;
-    sum += byte(c);
     break;
   }
   return valid_sentence;
 }
 
+#ifndef GPS_PROFILE
+
+// Printable characters that parse_nmea() adds to a term
+static inline bool is_term_char(char c) {
+  return c > ' ' && c <= '~' && c != ',' && c != '*' && c != '$' && c != '@' && c != ':';
+}
+
+//Same as parse_nmea() for the characters of a term that are not delimiters,
+//with the parsing state in registers. Stops before anything the state machine
+//handles: delimiters, illegal characters and a full term buffer
+const char *FarmGPS::parse_run(const char *buffer, const char *end) {
+#ifndef GPS_NO_STATS
+  const char *_run = buffer;
+#endif
+  byte _parity = parity;
+
+  if (is_wanted_term) {
+    unsigned long _integer = term_integer;
+    unsigned long _fraction = term_fraction;
+    byte _decimals = term_decimals;
+    bool _in_fraction = term_in_fraction;
+    byte _offset = term_offset;
+    while (buffer < end && _offset < sizeof (term) - 1) {
+      char c = *buffer;
+      if (c >= '0' && c <= '9') {
+        if (!_in_fraction) {
+          _integer = _integer * 10 + (c - '0');
+        }
+        else if (_decimals < 9) {
+          _fraction = _fraction * 10 + (c - '0');
+          _decimals++;
+        }
+      }
+      else if (c == '.') {
+        _in_fraction = true;
+      }
+      else if (c == '-') {
+        term_negative = true;
+      }
+      else if (!is_term_char(c)) {
+        break;
+      }
+      term[_offset++] = c;
+      _parity ^= c;
+      buffer++;
+    }
+    term_integer = _integer;
+    term_fraction = _fraction;
+    term_decimals = _decimals;
+    term_in_fraction = _in_fraction;
+    term_offset = _offset;
+  }
+  else {
+    while (buffer < end) {
+      char c = *buffer;
+      if (!is_term_char(c))
+        break;
+      _parity ^= c;
+      buffer++;
+    }
+  }
+
+  parity = _parity;
+#ifndef GPS_NO_STATS
+  statistics.encoded_characters += buffer - _run;
+#endif
+  return buffer;
+}
+
+#endif
+
+#ifndef GPS_NO_TRIMBLE
+
+//Trimble decoder, unstuffs the frame and passes its payload to the NMEA decoder
+//two bytes late, the two bytes in front of DLE ETX are the sum
+bool FarmGPS::parse_trimble(byte c) {
+  if (trimble_state == TRIMBLE_DLE) {
+    trimble_state = TRIMBLE_DATA;
+    if (c == GPS_TRIMBLE_ETX) {
+      trimble_state = TRIMBLE_IDLE;
+      if (trimble_length < 2 ||
+          trimble_sum != (unsigned int)(trimble_delay[0] << 8 | trimble_delay[1])) {
+#ifndef GPS_NO_STATS
+        statistics.failed_trimble++;
+#endif
+        sentence_type = OTHER;
+        return false;
+      }
+      // the sum ends the last term of the payload
+      if (sentence_type >= OTHER)
+        return false;
+      term[term_offset] = '\0';
+      parse_term();
+      term_number++;
+      return commit();
+    }
+    if (c != GPS_TRIMBLE_DLE) {
+      // DLE that is not stuffed, the frame is lost
+      trimble_state = TRIMBLE_IDLE;
+#ifndef GPS_NO_STATS
+      statistics.failed_trimble++;
+#endif
+      sentence_type = OTHER;
+      return false;
+    }
+    // stuffed DLE, fall through as data
+  }
+  else if (c == GPS_TRIMBLE_DLE) {
+    trimble_state = TRIMBLE_DLE;
+    return false;
+  }
+
+  // frames without an end are dropped
+  if (++trimble_length > GPS_TRIMBLE_LENGTH) {
+    trimble_state = TRIMBLE_IDLE;
+#ifndef GPS_NO_STATS
+    statistics.failed_trimble++;
+#endif
+    sentence_type = OTHER;
+    return false;
+  }
+
+  // delay line, the oldest byte is payload once a third byte arrives
+  bool valid_sentence = false;
+  if (trimble_length > 2 && trimble_delay[0] == GPS_TRIMBLE_START) {
+    // payload is ascii, the previous frame was cut off and this one started
+#ifndef GPS_NO_STATS
+    statistics.failed_trimble++;
+#endif
+    sentence_type = OTHER;
+    trimble_length = 2;
+    trimble_sum = 0;
+  }
+  else if (trimble_length > 2) {
+    trimble_sum += trimble_delay[0];
+    valid_sentence = parse_nmea(trimble_delay[0]);
+  }
+  trimble_delay[0] = trimble_delay[1];
+  trimble_delay[1] = c;
+  return valid_sentence;
+}
+
+#endif
+
+#ifdef GPS_PROFILE
+
+// Adds a measurement to a profile slot
+void FarmGPS::profile_record(byte slot, unsigned long clock) {
+  Profile &p = profiles[slot];
+  if (clock < p.min)
+    p.min = clock;
+  if (clock > p.max)
+    p.max = clock;
+  // halve both before the total wraps, the mean stays
+  if (p.total > 0xFFFFFFFF - clock || p.count == 0xFFFFFFFF) {
+    p.total /= 2;
+    p.count /= 2;
+  }
+  p.total += clock;
+  p.count++;
+}
+
+#endif
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+//After receiving character, decode it
+bool FarmGPS::decode(char c) {
+#ifdef GPS_PROFILE
+  unsigned long _start = GPS_PROFILE_CLOCK();
+  bool valid_sentence = parse_char(c);
+  unsigned long _clock = GPS_PROFILE_CLOCK() - _start;
+
+  profile_record(0, _clock);
+  if (valid_sentence && sentence_type < OTHER)
+    profile_record(sentence_type + 1, _clock);
+  return valid_sentence;
+#else
+  return parse_char(c);
+#endif
+}
+
+//After receiving a chunk of characters, decode all sentences in it
+unsigned int FarmGPS::decode_buffer(const char *buffer, size_t length) {
+  unsigned int completed = 0;
+  const char *end = buffer + length;
+  const char *sentence_start = 0;
+
+  // line end of the sentence forwarded at the end of the last buffer
+  if (forward_pending && buffer < end && *buffer == '\n' && config->forward)
+    config->forward(*this, forward_pending, buffer, 1);
+  forward_pending = 0;
+
+  // stamps given by set_start() only apply to a sentence starting the buffer,
+  // the loop below may take its first characters without parse_char()
+  if (start_given && buffer < end && *buffer != '$' && *buffer != '@' && byte(*buffer) != GPS_TRIMBLE_START)
+    start_given = false;
+
+  while (buffer < end) {
+    // unwanted sentence, skip without tokenizing up to the next sentence start
+    if (sentence_type == OTHER && term_number > 0 && !in_frame()) {
+#ifndef GPS_NO_STATS
+      const char *skip = buffer;
+#endif
+      while (buffer < end && *buffer != '$' && *buffer != '@' && byte(*buffer) != GPS_TRIMBLE_START)
+        buffer++;
+#ifndef GPS_NO_STATS
+      statistics.encoded_characters += buffer - skip;
+      statistics.skipped_characters += buffer - skip;
+#endif
+      if (buffer == end)
+        break;
+    }
+
+#ifndef GPS_PROFILE
+    // inside a term, take the characters up to its end at once, profiling
+    // measures decode() per character
+    if (!is_checksum_term && !in_frame() && (sentence_type != OTHER || term_number == 0)) {
+      buffer = parse_run(buffer, end);
+      if (buffer == end)
+        break;
+    }
+#endif
+
+    // start of the sentence for pass-through, bytes inside a Trimble frame are payload
+    char c = *buffer;
+    if (!in_frame() && (c == '$' || c == '@' || byte(c) == GPS_TRIMBLE_START))
+      sentence_start = buffer;
+
+    if (decode(*buffer++) && sentence_type != OTHER) {
+      completed |= 1 << sentence_type;
+
+      // forwarded with the flag of the callback, ROXTE as GPS_SENTENCE_XTE
+      byte _flag;
+      memcpy_P(&_flag, &sentences[schema].flag, 1);
+      unsigned int _sentence = _flag;
+      if (config->forward && (config->forward_sentences & _sentence)) {
+        if (sentence_start) {
+          // hand out the sentence including its line end, a '\n' in the next
+          // buffer follows by itself
+          const char *sentence_end = buffer;
+          if (c == '\r' && sentence_end < end && *sentence_end == '\n')
+            sentence_end++;
+          else if (c == '\r' && sentence_end == end)
+            forward_pending = _sentence;
+          config->forward(*this, _sentence, sentence_start, sentence_end - sentence_start);
+        }
+#ifndef GPS_NO_STATS
+        else {
+          statistics.unforwarded++;
+        }
+#endif
+      }
+      sentence_start = 0;
+    }
+  }
+  return completed;
+}
+
+//Copies the committed fix, retries when a commit interrupted the copy
+void FarmGPS::read_fix(GpsFix &outfix) {
+  byte sequence;
+  do {
+    sequence = fix_sequence;
+    GPS_BARRIER();
+    outfix = fix;
+    GPS_BARRIER();
+  } while ((sequence & 1) || sequence != fix_sequence);
+}
+
+//Constant velocity dead reckoning from the last GGA, the velocity trig is
+//computed once per VTG here instead of in the commit, which may run in an ISR
+bool FarmGPS::get_position_at(unsigned long time, long *outlatitude, long *outlongitude) {
+  GpsFix _fix;
+  read_fix(_fix);
+  if (_fix.latitude == GPS_INVALID_ANGLE)
+    return false;
+
+  if (_fix.speed != velocity_speed || _fix.course != velocity_course) {
+    velocity_speed = _fix.speed;
+    velocity_course = _fix.course;
+    velocity_north = velocity_east = 0;
+    if (_fix.speed != GPS_INVALID_FLOAT && _fix.course != GPS_INVALID_FLOAT) {
+      float _speed = _fix.speed * GPS_MS_PER_KNOT / 1000 / GPS_METERS_PER_E7;
+      float _course = radians(_fix.course);
+      velocity_north = _speed * cos(_course);
+      velocity_east = _speed * sin(_course) / cos(radians(_fix.latitude / 10000000.0));
+    }
+  }
+
+  long _age = time - _fix.last_GGA_fix;
+  bool _valid = _age <= GPS_PREDICTION_LIMIT;
+  if (_age < 0)
+    _age = 0;
+  else if (!_valid)
+    _age = GPS_PREDICTION_LIMIT;
+
+  if (outlatitude) *outlatitude = _fix.latitude + long(velocity_north * _age);
+  if (outlongitude) *outlongitude = _fix.longitude + long(velocity_east * _age);
+  return _valid;
+}
+
+//One multiply-add on the clock fit, read like read_fix() as commit() may run in an ISR
+unsigned long FarmGPS::get_utc_at(unsigned long time) {
+  byte sequence;
+  unsigned long _utc, _millis;
+  float _rate;
+  do {
+    sequence = fix_sequence;
+    GPS_BARRIER();
+    _utc = clock_utc;
+    _millis = clock_millis;
+    _rate = clock_rate;
+    GPS_BARRIER();
+  } while ((sequence & 1) || sequence != fix_sequence);
+
+  if (_utc == GPS_INVALID_LONG)
+    return GPS_INVALID_LONG;
+  long _utc_at = _utc + long(long(time - _millis) * _rate);
+  if (_utc_at < 0)
+    _utc_at += GPS_DAY_MS;
+  return _utc_at % GPS_DAY_MS;
+}
+
+// Little endian field writers for encode_fix()
+static byte *put_16(byte *out, unsigned int value) {
+  *out++ = value;
+  *out++ = value >> 8;
+  return out;
+}
+
+static byte *put_32(byte *out, unsigned long value) {
+  out = put_16(out, value);
+  return put_16(out, value >> 16);
+}
+
+// Scales a value to the units of a record field, clamped to the range of the
+// field below its invalid marker
+static long record_value(float value, float scale, long low, long high) {
+  float _scaled = value * scale;
+  if (_scaled <= low)
+    return low;
+  if (_scaled >= high)
+    return high;
+  return long(_scaled);
+}
+
+//Writes the record field by field straight into the output buffer
+void FarmGPS::encode_fix(byte *out) {
+  GpsFix _fix;
+  read_fix(_fix);
+
+  *out++ = GPS_FIX_RECORD_VERSION;
+  *out++ = _fix.quality;
+  out = put_32(out, _fix.time);
+  out = put_32(out, _fix.latitude);
+  out = put_32(out, _fix.longitude);
+  out = put_32(out, _fix.altitude == GPS_INVALID_FLOAT ? GPS_INVALID_LONG :
+    record_value(_fix.altitude, 100, -0x7FFFFFFFL, 0x7FFFFFFEL));
+  out = put_16(out, _fix.speed == GPS_INVALID_FLOAT ? 0xFFFF :
+    record_value(_fix.speed, GPS_MS_PER_KNOT * 100, 0, 0xFFFE));
+  out = put_16(out, _fix.course == GPS_INVALID_FLOAT ? 0xFFFF :
+    record_value(_fix.course, 100, 0, 0xFFFE));
+  out = put_16(out, _fix.xte == GPS_INVALID_FLOAT ? 0x7FFF :
+    record_value(_fix.xte, 100, -0x7FFF, 0x7FFE));
+  put_32(out, _fix.last_GGA_fix);
+}
+
+//Consistent overhead byte stuffing: every 0 is replaced by the distance to the
+//next 0, so the frame holds no 0 but its delimiter
+size_t FarmGPS::cobs_encode(const byte *in, size_t length, byte *out) {
+  byte *code = out;
+  byte *dst = out + 1;
+  byte distance = 1;
+
+  for (size_t i = 0; i < length; i++) {
+    if (in[i]) {
+      *dst++ = in[i];
+      distance++;
+    }
+    if (!in[i] || distance == 0xFF) {
+      *code = distance;
+      code = dst++;
+      distance = 1;
+    }
+  }
+  *code = distance;
+  *dst++ = 0;
+  return dst - out;
+}
+
 float FarmGPS::distance_between(float lat1, float long1, float lat2, float long2) {
   // returns distance in meters between two positions, both specified 
   // as signed decimal-degrees latitude and longitude. Uses great-circle 
@@ -354,14 +1276,78 @@ float FarmGPS::distance_between(float lat1, float long1, float lat2, float long2
   return delta * 6372795;
 }
 
+bool FarmGPS::baseline_between(const GpsFix &primary, const GpsFix &secondary,
+  float *heading, float *pitch, float *length) {
+  if (primary.time != secondary.time || primary.time == GPS_INVALID_LONG ||
+      primary.latitude == GPS_INVALID_ANGLE || secondary.latitude == GPS_INVALID_ANGLE)
+    return false;
+
+  // antennas are meters apart, the tangent plane of the primary is exact enough
+  float east, north;
+  GeoReference(primary.latitude, primary.longitude).to_local(secondary.latitude, secondary.longitude, &east, &north);
+  float horizontal = sqrt(east * east + north * north);
+
+  if (heading) {
+    *heading = degrees(atan2(east, north));
+    if (*heading < 0)
+      *heading += 360;
+  }
+  if (pitch) {
+    if (primary.altitude == GPS_INVALID_FLOAT || secondary.altitude == GPS_INVALID_FLOAT)
+      *pitch = GPS_INVALID_FLOAT;
+    else
+      *pitch = degrees(atan2(secondary.altitude - primary.altitude, horizontal));
+  }
+  if (length) {
+    *length = horizontal;
+  }
+  return true;
+}
+
+void FarmGPS::distances_from(const GeoReference &reference, const int32_t *latitudes,
+  const int32_t *longitudes, float *out, unsigned int n) {
+  reference.distances(latitudes, longitudes, out, n);
+}
+
 #ifndef GPS_NO_STATS
 
-void FarmGPS::stats(unsigned long *chars, unsigned short *sentences, unsigned short *failed_cs) {
-  if (chars) *chars = encoded_characters;
-  if (sentences) *sentences = good_sentences;
-  if (failed_cs) *failed_cs = failed_checksum;
+void FarmGPS::stats(unsigned long *chars, unsigned long *sentences, unsigned long *failed_cs) {
+  if (chars) *chars = statistics.encoded_characters;
+  if (sentences) *sentences = statistics.good_sentences;
+  if (failed_cs) *failed_cs = statistics.failed_checksum;
+}
+
+void FarmGPS::stats(GpsStats &outstats) {
+  outstats = statistics;
 }
 
 #endif
 
+#ifdef GPS_PROFILE
+
+void FarmGPS::profile(unsigned int sentence, unsigned long *min, unsigned long *max, unsigned long *mean) {
+  // the lowest flag set, slots follow the sentence types
+  byte slot = 0;
+  for (byte i = 0; i < GPS_SENTENCE_TYPES; i++) {
+    if (sentence & 1 << i) {
+      slot = i + 1;
+      break;
+    }
+  }
+
+  Profile &p = profiles[slot];
+  if (min) *min = p.count ? p.min : 0;
+  if (max) *max = p.max;
+  if (mean) *mean = p.count ? p.total / p.count : 0;
+}
+
+void FarmGPS::reset_profile() {
+  for (byte i = 0; i < GPS_SENTENCE_TYPES + 1; i++) {
+    profiles[i].min = 0xFFFFFFFF;
+    profiles[i].max = 0;
+    profiles[i].total = 0;
+    profiles[i].count = 0;
+  }
+}
 
+#endif
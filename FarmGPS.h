@@ -21,7 +21,25 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef FarmGPS_h
 #define FarmGPS_h
 
-#if ARDUINO <= 22
+#if !defined(ARDUINO)
+// host build for benchmarks and offline tools, the program provides millis() and micros()
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+typedef uint8_t byte;
+typedef bool boolean;
+unsigned long millis();
+unsigned long micros();
+#define radians(deg) ((deg) * M_PI / 180.0)
+#define degrees(rad) ((rad) * 180.0 / M_PI)
+#define sq(x) ((x) * (x))
+#define noInterrupts()
+#define interrupts()
+#define PROGMEM
+#define memcpy_P memcpy
+#elif ARDUINO <= 22
 #include "WProgram.h"
 #else
 #include "Arduino.h"
@@ -30,22 +48,202 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // software version of this library
 #define GPS_VERSION 0.7
 
-// conversion constants
-#define GPS_MPH_PER_KNOT 1.15077945
-#define GPS_MS_PER_KNOT 0.51444444
-#define GPS_KMH_PER_KNOT 1.852
-#define GPS_MILES_PER_METER 0.00062137112
-#define GPS_KM_PER_METER 0.001
+// conversion constants, float so unit conversions stay single precision on 32 bit targets
+#define GPS_MPH_PER_KNOT 1.15077945f
+#define GPS_MS_PER_KNOT 0.51444444f
+#define GPS_KMH_PER_KNOT 1.852f
+#define GPS_MILES_PER_METER 0.00062137112f
+#define GPS_KM_PER_METER 0.001f
+
+// Trimble binary framing: start, payload, sum high, sum low, DLE, ETX
+// DLE bytes in the payload and sum are sent twice, the sum adds all payload bytes
+#define GPS_TRIMBLE_START  191
+#define GPS_TRIMBLE_DLE    16
+#define GPS_TRIMBLE_ETX    3
+#define GPS_TRIMBLE_LENGTH 96   // longer frames are dropped
+
+// sentence flags returned by decode_buffer()
+#define GPS_SENTENCE_GGA   0x0001
+#define GPS_SENTENCE_VTG   0x0002
+#define GPS_SENTENCE_XTE   0x0004
+#define GPS_SENTENCE_ROXTE 0x0008
+#define GPS_SENTENCE_GST   0x0010
+#define GPS_SENTENCE_RMC   0x0020
+#define GPS_SENTENCE_HDT   0x0040
+#define GPS_SENTENCE_PJK   0x0080
+#define GPS_SENTENCE_EPOCH 0x8000  // callback only, all epoch sentences arrived
+
+// number of sentence types, for the per sentence statistics
+#define GPS_SENTENCE_TYPES 8
+
+// sentences, protocols and statistics to compile in
+#include "FarmGPSConfig.h"
+
+// fields for set_interest(), sentences without wanted fields are skipped
+#define GPS_GGA_TIME       0x0001
+#define GPS_GGA_POSITION   0x0002
+#define GPS_GGA_QUALITY    0x0004
+#define GPS_GGA_ALTITUDE   0x0008
+#define GPS_VTG_COURSE     0x0010
+#define GPS_VTG_SPEED      0x0020
+#define GPS_XTE_DISTANCE   0x0040
+#define GPS_GST_ACCURACY   0x0080
+#define GPS_RMC_TIME       0x0100  // time and date
+#define GPS_RMC_POSITION   0x0200
+#define GPS_RMC_MOTION     0x0400  // speed and course
+#define GPS_HDT_HEADING    0x0800
+#define GPS_PJK_POSITION   0x1000
+#define GPS_ALL_FIELDS     0x1FFF
+
+// default maximum time in milliseconds between consecutive sentences of one epoch
+#define GPS_EPOCH_GAP 500
+
+// maximum time in milliseconds get_position_at() extrapolates beyond the last GGA
+#define GPS_PREDICTION_LIMIT 1000
+
+// GPS clock fit of get_utc_at(), restarted when a sentence start is more than
+// GPS_CLOCK_SLEW milliseconds off the fit or GPS_CLOCK_HOLD milliseconds after the last
+#define GPS_CLOCK_SLEW 1000
+#define GPS_CLOCK_HOLD 10000
+
+// milliseconds a PPS edge aligns the fix stamps after it is paired with a
+// whole second of the GPS time
+#define GPS_PPS_HOLD 2000
+
+// binary fix record of encode_fix(), little endian:
+//  0 version, 1 quality, 2 time in centiseconds since midnight, 6 latitude and 10 longitude in degrees * 10^7,
+// 14 altitude in cm, 18 speed in cm/s, 20 course in centidegrees, 22 xte in cm,
+// 24 millis() of the GGA; invalid fields are all ones, GPS_INVALID_ANGLE for
+// latitude and longitude and 0x7FFF for xte, values beyond the range of a field
+// are clamped to it
+#define GPS_FIX_RECORD_VERSION 2
+#define GPS_FIX_RECORD_SIZE 28
+
+// worst case size of a COBS frame including the 0 delimiter
+#define GPS_COBS_SIZE(length) ((length) + (length) / 254 + 2)
+
+#define GPS_INVALID_FLOAT 999999.9f
+#define GPS_INVALID_LONG 0xFFFFFFFF
+#define GPS_INVALID_ANGLE 999999999
+
+#ifdef GPS_PROFILE
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define GPS_PROFILE_CLOCK() (*(volatile unsigned long *)0xE0001004)  // DWT->CYCCNT
+#else
+#define GPS_PROFILE_CLOCK() micros()
+#endif
+#endif
 
-#define GPGGA_TERM   "GPGGA"
-#define GPVTG_TERM   "GPVTG"
-#define GPXTE_TERM   "GPXTE"
-#define ROXTE_TERM   "ROXTE"
+// compiler barrier, keeps the fix publish steps in order for readers in other contexts
+#define GPS_BARRIER() __asm__ __volatile__ ("" ::: "memory")
 
-#define GPS_INVALID_FLOAT 999999.9
-#define GPS_INVALID_LONG 0xFFFFFFFF
+// UTC date, day 0 while unknown
+struct GpsDate {
+  byte day;
+  byte month;
+  byte year;                  // two digits, above 80 in the 1900s
+};
 
-#define GPS_NO_STATS
+// committed nmea items of the last validated sentences
+struct GpsFix {
+  unsigned long time;         // UTC centiseconds since midnight
+  GpsDate date;
+  long latitude;              // degrees * 10^7
+  long longitude;             // degrees * 10^7
+  float altitude;             // meters
+  float speed;                // knots
+  float course;               // degrees
+  float xte;                  // meters
+  int quality;
+
+  // millis() at commit of the sentence, at the epoch of the fix time while
+  // pps() is called, sentences without time take the epoch of the last time
+  // RMC stamps the GGA position and VTG motion it updates
+  unsigned long last_GGA_fix;
+  unsigned long last_VTG_fix;
+  unsigned long last_XTE_fix;
+
+  // millis() at completion of the epoch, or its PPS epoch, and its GGA time
+  unsigned long last_epoch;
+  unsigned long epoch_time;
+
+  // arrival of the '$' or start byte of the last committed sentence, without
+  // the transmission time of the sentence in the commit stamps above
+  unsigned long last_start;   // millis()
+#ifdef GPS_STAMP_CLOCK
+  unsigned long last_stamp;   // GPS_STAMP_CLOCK()
+#endif
+
+#ifdef GPGST_TERM
+  // GST pseudorange rms and 1 sigma position errors in meters
+  float rms;
+  float latitude_error;
+  float longitude_error;
+  float altitude_error;
+  unsigned long last_GST_fix;
+#endif
+#ifdef GPRMC_TERM
+  unsigned long last_RMC_fix;
+#endif
+#ifdef GPHDT_TERM
+  float heading;              // degrees true
+  unsigned long last_HDT_fix;
+#endif
+#ifdef PTNL_PJK_TERM
+  // PTNL,PJK local grid position, Trimble quality 0 none, 1 autonomous, 2 RTK float, 3 RTK fix, 4 DGPS
+  long northing;              // centimeters
+  long easting;               // centimeters
+  float grid_height;          // meters
+  int grid_quality;
+  unsigned long last_PJK_fix;
+#endif
+};
+
+#ifndef GPS_NO_STATS
+// decoder statistics, per sentence counters are indexed GGA, VTG, XTE, ROXTE, GST, RMC, HDT, PJK
+struct GpsStats {
+  unsigned long encoded_characters;
+  unsigned long skipped_characters;   // in sentences that were not parsed
+  unsigned long good_sentences;
+  unsigned long failed_checksum;
+  unsigned long sentences[GPS_SENTENCE_TYPES];
+  unsigned long failed[GPS_SENTENCE_TYPES];
+  unsigned long unknown_sentences;    // sentence ids not parsed by this library
+  unsigned long term_overflows;       // overlong terms, their sentence is dropped
+  unsigned long aborted_sentences;    // dropped at an illegal character or an overlong term
+  unsigned long failed_trimble;       // Trimble frames with a bad checksum
+  unsigned long unforwarded;          // sentences to forward split over two buffers
+};
+#endif
+
+class FarmGPS;
+class GeoReference;
+
+// callback for validated sentences, runs within decode() right after the commit
+// sentence is the GPS_SENTENCE_* flag, ROXTE is reported as GPS_SENTENCE_XTE
+typedef void (*GpsCallback)(FarmGPS &gps, unsigned int sentence, const GpsFix &fix);
+
+// forwarder for validated sentences, data points into the buffer passed to decode_buffer()
+// and holds the sentence as received, from '$' (or Trimble 191) up to and including "\r\n" (or 16, 3)
+// a buffer ending between '\r' and '\n' forwards the '\n' by itself at the start of the next
+// sentence is the flag passed to the callback, ROXTE is forwarded as GPS_SENTENCE_XTE
+typedef void (*GpsForwardCallback)(FarmGPS &gps, unsigned int sentence, const char *data, size_t length);
+
+// parser configuration, can be shared by the decoders of several receivers:
+//   GpsConfig config = GPS_DEFAULT_CONFIG;
+//   FarmGPS rover(config), base(config);
+// Decoders constructed without a configuration keep a default one of their own
+struct GpsConfig {
+  unsigned int interest;        // GPS_* fields to parse
+  unsigned int epoch_sentences; // GPS_SENTENCE_* flags making up an epoch
+  unsigned int epoch_gap;       // most milliseconds between consecutive sentences of one epoch
+  GpsCallback callback;
+  GpsForwardCallback forward;
+  unsigned int forward_sentences; // GPS_SENTENCE_* flags to forward
+};
+
+#define GPS_DEFAULT_CONFIG \
+  { GPS_ALL_FIELDS, GPS_SENTENCE_GGA | GPS_SENTENCE_VTG, GPS_EPOCH_GAP, 0, 0, 0xFFFF }
 
 class FarmGPS {
 private:
@@ -53,85 +251,349 @@ private:
   // data members
   //-------------
 
-  // nmea items
-  float time, new_time;
-  unsigned long date, new_date;
-  float latitude, new_latitude;
-  float longitude, new_longitude;
-  float altitude, new_altitude;
-  float speed, new_speed;
-  float course, new_course;
-  float xte, new_xte;
-  int quality, new_quality;
-
-  // timekeepers
-  unsigned long last_GGA_fix, new_GGA_fix;
-  unsigned long last_VTG_fix, new_VTG_fix;
-  unsigned long last_XTE_fix, new_XTE_fix;
+  // committed nmea items, published under fix_sequence
+  GpsFix fix;
+  volatile byte fix_sequence;
+
+  // configuration given to the constructor, or the own one
+  GpsConfig *config;
+  GpsConfig own_config;
+
+  // nmea items of the sentence being parsed, one sentence at a time
+  // in the value slots of its schema fields
+  union Value {
+    float f;
+    long l;
+    int i;
+    GpsDate d;
+  };
+#ifdef GPRMC_TERM
+  Value pending[6];
+#else
+  Value pending[5];
+#endif
 
   // flags for usage monitoring
   boolean new_GGA_data;
   boolean new_VTG_data;
   boolean new_XTE_data;
+  boolean new_epoch_data;
 
-  // parsing state variables
-  char term[20];
+  // millis() at the start of the sentence being parsed
+  unsigned long sentence_millis;
+#ifdef GPS_STAMP_CLOCK
+  unsigned long sentence_stamp;
+#endif
+  // stamps of the next start given by set_start()
+  unsigned long given_millis;
+#ifdef GPS_STAMP_CLOCK
+  unsigned long given_stamp;
+#endif
+  boolean start_given;
+
+  // running fit of the GPS clock, UTC milliseconds since midnight at a millis() time
+  unsigned long clock_millis;
+  unsigned long clock_utc;      // GPS_INVALID_LONG without fit
+  float clock_rate;             // UTC milliseconds per millis() millisecond
+
+  // PPS edges counted and stamped by pps(), the last edge paired with a whole second
+  volatile byte pps_edges;
+  volatile unsigned long pps_millis;
+  byte pps_paired;
+  unsigned long pps_utc;        // GPS time of the paired edge, GPS_INVALID_LONG without
+  unsigned long pps_at;         // millis() of the paired edge
+
+  // epoch assembly, GPS_SENTENCE_* flags received so far and millis() of the
+  // last sentence
+  unsigned int epoch_pending;
+  unsigned long epoch_last;
+
+  // VTG velocity in degrees * 10^7 per millisecond, computed on demand
+  float velocity_north;
+  float velocity_east;
+  float velocity_speed;
+  float velocity_course;
+
+  // parsing state variables, numbers are accumulated per character so the term
+  // only needs the longest wanted term, e.g. dddmm.mmmmmmmmm
+  char term[16];
   byte term_number;
   byte term_offset;
   byte parity;
-  byte checksum;
-  int sum;
   bool is_checksum_term;
 
-  // sentence type of decoded message
+  // terms of the current sentence holding subscribed fields
+  unsigned int term_interest;
+  bool is_wanted_term;
+
+  // GPS_SENTENCE_* flag of a sentence forwarded up to its '\r' at the end of a buffer
+  byte forward_pending;
+
+  // fixed-point value of the current term, accumulated per character
+  unsigned long term_integer;
+  unsigned long term_fraction;
+  byte term_decimals;
+  bool term_in_fraction;
+  bool term_negative;
+
+  // sentence type of decoded message, order matches the GPS_SENTENCE_* flags
+  // PTNL is a proprietary sentence identified by its next term
   enum types{
-    GGA, VTG, XTE, XTE2, OTHER
+    GGA, VTG, XTE, XTE2, GST, RMC, HDT, PJK, OTHER, PTNL
   };
   types sentence_type;
 
-#ifndef _GPS_NO_STATS
+  // sentence schema, tables in FarmGPS.cpp, in PROGMEM on AVR
+  enum decoders{
+    DECIMAL,      // float
+    DEGREES,      // ddmm.mmmm to long degrees * 10^7
+    HEMISPHERE,   // S or W negates the value
+    INTEGER,      // int
+    TIME,         // hhmmss.ss to unsigned long centiseconds since midnight
+    DATE,         // ddmmyy to GpsDate
+    CENTIMETERS,  // meters to long centimeters
+    STATUS        // A for valid, other sentences are dropped
+  };
+  struct Field {
+    byte term;
+    byte decoder;
+    byte slot;            // offset in GpsFix
+    byte value;           // index in pending
+    uint16_t interest;    // GPS_* fields
+  };
+  struct Sentence {
+    byte flag;            // GPS_SENTENCE_* flag reported to callbacks
+    byte stamp;           // offset of the millis() commit stamp in GpsFix
+    byte count;
+    const Field *fields;
+  };
+  static const Field gga_fields[], vtg_fields[], xte_fields[], roxte_fields[],
+    gst_fields[], rmc_fields[], hdt_fields[], pjk_fields[];
+  static const Sentence sentences[];
+
+  // schema of the current sentence and its next field
+  byte schema;
+  byte schema_field;
+
+#ifndef GPS_NO_TRIMBLE
+  // Trimble frame, the payload lags two bytes behind so the sum never reaches a term
+  enum trimble_states{
+    TRIMBLE_IDLE, TRIMBLE_DATA, TRIMBLE_DLE
+  };
+  trimble_states trimble_state;
+  byte trimble_delay[2];
+  byte trimble_length;
+  unsigned int trimble_sum;
+#endif
+
+#ifndef GPS_NO_STATS
   // statistics
-  unsigned long encoded_characters;
-  unsigned long good_sentences;
-  unsigned long failed_checksum;
-  unsigned long passed_checksum;
+  GpsStats statistics;
+#endif
+
+#ifdef GPS_PROFILE
+  // min, max and total clock of decode() per character and per committed
+  // sentence type, total and count are halved together before the total wraps
+  struct Profile {
+    unsigned long min, max, total, count;
+  };
+  Profile profiles[GPS_SENTENCE_TYPES + 1];
 #endif
   //----------------------------------------------------
   // private member functions implemented in FarmGPS.cpp
   //----------------------------------------------------
 
-  // Convert string to decimal or degrees
-  float parse_decimal(const char *s);
-  float parse_degrees(const char *s);
-  int parse_integer(const char *s);
-  
-  // Compares two strings, returns true when the same
-  bool strcmp(const char *str1, const char *str2);
+  // Accumulate a term character into the fixed-point term value
+  void reset_number();
+  void parse_digit(char c);
 
-  // Convert ascii hexadecimal to integer
+  // Convert fixed-point term value to decimal, degrees, integer or scaled integer
+  float parse_decimal();
+  long parse_degrees();
+  int parse_integer();
+  long parse_fixed(byte decimals);
+  unsigned long parse_time();
+  
+  // Convert ascii hexadecimal to integer, 16 for other characters
   int hex_to_int(char c);
   
   // Checks whether nmea term is a complete term
   bool parse_term();
 
+  // Finds the schema of the sentence in term, and the terms of interest
+  void parse_sentence_id();
+
+  // Copies the values of the current schema from or to the fix
+  void schema_copy(bool to_fix);
+
+  // Follows the GPS clock with the millis() at the start of a sentence with a new time
+  void clock_update(unsigned long utc, unsigned long time);
+
+  // Publishes the fields of a validated sentence
+  bool commit();
+
+  // millis() at the epoch of the fix time from the PPS edges, or now without
+  unsigned long pps_align(unsigned long now);
+
+  // Drops the sentence being parsed, decode() skips to the next sentence start
+  void abort_sentence();
+
+  // Processes a character, called by decode(), hands it to the decoder of its protocol
+  bool parse_char(char c);
+  bool parse_nmea(char c);
+#ifndef GPS_PROFILE
+  // Takes the ordinary characters of an NMEA term up to its end, called by
+  // decode_buffer(), returns the first byte not taken
+  const char *parse_run(const char *buffer, const char *end);
+#endif
+#ifndef GPS_NO_TRIMBLE
+  bool parse_trimble(byte c);
+#endif
+
+  // True while a frame of a binary protocol owns the incoming bytes
+  inline bool in_frame() {
+#ifndef GPS_NO_TRIMBLE
+    return trimble_state != TRIMBLE_IDLE;
+#else
+    return false;
+#endif
+  }
+
+  // Stamps the start of a sentence
+  inline void start_sentence() {
+    if (start_given) {
+      start_given = false;
+      sentence_millis = given_millis;
+#ifdef GPS_STAMP_CLOCK
+      sentence_stamp = given_stamp;
+#endif
+      return;
+    }
+    sentence_millis = millis();
+#ifdef GPS_STAMP_CLOCK
+    sentence_stamp = GPS_STAMP_CLOCK();
+#endif
+  }
+
+#ifdef GPS_PROFILE
+  void profile_record(byte slot, unsigned long clock);
+#endif
+
+  // Initializes the decoder state, called by the constructors
+  void init(GpsConfig *config);
 
 public:
   //--------------------------------------------------
   //public member functions implemented in FarmGPS.cpp
   //--------------------------------------------------
 
-  //Constructor
+  //Constructors, with a default configuration of this instance or with one
+  //that may be shared with other instances
   FarmGPS();
+  FarmGPS(GpsConfig &config);
 
   // Processes characters received from GPS
   bool decode(char c);
 
+  // The setters below change the configuration, a shared one for all its instances
+
+  // Selects the GPS_* fields to parse, other terms and sentences are skipped
+  inline void set_interest(unsigned int fields) {
+    config->interest = fields;
+  }
+
+  // Selects the GPS_SENTENCE_* flags completing an epoch, a sentence more than
+  // gap milliseconds after the one before or a repeated sentence starts a new
+  // epoch
+  inline void set_epoch(unsigned int sentences, unsigned int gap = GPS_EPOCH_GAP) {
+    config->epoch_sentences = sentences;
+    config->epoch_gap = gap;
+  }
+
+  // Sets the function called for each committed sentence and completed epoch, 0 for none
+  inline void set_callback(GpsCallback function) {
+    config->callback = function;
+  }
+
+  // Sets the function passed the validated GPS_SENTENCE_* sentences of decode_buffer()
+  // as received, 0 for none. Sentences split over two buffers are not forwarded
+  inline void set_forward(GpsForwardCallback function, unsigned int sentences = 0xFFFF) {
+    config->forward = function;
+    config->forward_sentences = sentences;
+  }
+
+  // Stamps a PPS edge, call from its interrupt or with the capture of an input
+  // capture timer converted to millis(). The edge is paired with the next
+  // fix time on a whole second and aligns the fix stamps and ages to the epoch
+  inline void pps() {
+    pps(millis());
+  }
+  inline void pps(unsigned long time) {
+    pps_edges++;
+    pps_millis = time;
+  }
+
+  // Gives the arrival stamps of a sentence start decoded later from a buffer,
+  // they apply when the next character decoded starts a sentence and are
+  // dropped otherwise
+  inline void set_start(unsigned long time, unsigned long stamp = 0) {
+    given_millis = time;
+#ifdef GPS_STAMP_CLOCK
+    given_stamp = stamp;
+#else
+    (void)stamp;
+#endif
+    start_given = true;
+  }
+
+  // Processes a chunk of characters received from GPS, e.g. from Serial.readBytes()
+  // Returns GPS_SENTENCE_* flags of the sentences validated in this chunk
+  unsigned int decode_buffer(const char *buffer, size_t length);
+
+  // Copies a consistent snapshot of the committed fix, safe against decode() in an ISR
+  void read_fix(GpsFix &outfix);
+
+  // Position in degrees * 10^7 at a millis() time, extrapolated from the last GGA
+  // with the VTG speed and course. Returns false without a position or when the
+  // time is more than GPS_PREDICTION_LIMIT after the GGA
+  bool get_position_at(unsigned long time, long *outlatitude, long *outlongitude);
+
+  // UTC milliseconds since midnight at a millis() time, from a running fit of the GPS
+  // time to the start of its sentences, so it includes the output delay of the
+  // receiver. Returns GPS_INVALID_LONG before the first fix with a time
+  unsigned long get_utc_at(unsigned long time);
+
+  // Writes the committed fix as a GPS_FIX_RECORD_SIZE bytes binary record
+  void encode_fix(byte *out);
+
+  // Frames length bytes with COBS into out, which holds GPS_COBS_SIZE(length) bytes
+  // Returns the frame length including the trailing 0 delimiter
+  static size_t cobs_encode(const byte *in, size_t length, byte *out);
+
   // Calculates distance between two geographical points
   static float distance_between(float lat1, float long1, float lat2, float long2);
 
+  // Heading and pitch in degrees and length in meters of the baseline from a primary
+  // to a secondary antenna, from the GGA of both receivers. Returns false when
+  // the GGA times differ or a position is missing, pitch needs both altitudes
+  static bool baseline_between(const GpsFix &primary, const GpsFix &secondary,
+    float *heading, float *pitch = 0, float *length = 0);
+
+  // Calculates local distances in meters from a reference point for n positions in degrees * 10^7
+  static void distances_from(const GeoReference &reference, const int32_t *latitudes,
+    const int32_t *longitudes, float *out, unsigned int n);
+
   // Provides statistics
 #ifndef GPS_NO_STATS
-  void stats(unsigned long *chars, unsigned short *sentences, unsigned short *failed_cs);
+  void stats(unsigned long *chars, unsigned long *sentences, unsigned long *failed_cs);
+  void stats(GpsStats &outstats);
+#endif
+
+  // Provides profiling results for decode() per character (sentence 0), or for
+  // the characters committing a sentence of a GPS_SENTENCE_* flag other than _EPOCH
+#ifdef GPS_PROFILE
+  void profile(unsigned int sentence, unsigned long *min, unsigned long *max, unsigned long *mean);
+  void reset_profile();
 #endif
 
   //------------------------------
@@ -140,108 +602,156 @@ public:
   
   //in general all getters for this class
 
-  // date as ddmmyy, time as hhmmsscc, and age in milliseconds
+  // UTC time in centiseconds since midnight, GPS_INVALID_LONG while unknown
+  inline unsigned long get_time() {
+    return fix.time;
+  }
+
+  // UTC date, day 0 while unknown
+  inline GpsDate get_date() {
+    return fix.date;
+  }
+
+  // date as ddmmyy, time as hhmmsscc, GPS_INVALID_LONG while unknown
   inline void get_datetime(unsigned long *outdate, unsigned long *outtime) {
-    if (outdate) *outdate = date;
-    if (outtime) *outtime = time;
+    if (outdate)
+      *outdate = fix.date.day ? fix.date.day * 10000UL + fix.date.month * 100 + fix.date.year : GPS_INVALID_LONG;
+    if (outtime) {
+      unsigned long _s = fix.time / 100;
+      *outtime = fix.time == GPS_INVALID_LONG ? GPS_INVALID_LONG :
+        (_s / 3600 * 10000 + _s / 60 % 60 * 100 + _s % 60) * 100 + fix.time % 100;
+    }
   }
 
-  // date as dd, mm, yyyy, time as hh, mm, ss, cc, and age in milliseconds
+  // date as dd, mm, yyyy with years above 80 in the 1900s, time as hh, mm, ss, cc
   inline void get_datetime_details(int *outyear, byte *outmonth, byte *outday,
   byte *outhour, byte *outminute, byte *outsecond, byte *outhundredths = 0) {
-    unsigned long _d, _t;
-    get_datetime(&_d, &_t);
-    if (outyear) {
-      *outyear = _d % 100;
-      *outyear += *outyear > 80 ? 1900 : 2000;
-    }
-    if (outmonth) *outmonth = (_d / 100) % 100;
-    if (outday) *outday = _d / 10000;
-    if (outhour) *outhour = _t / 1000000;
-    if (outminute) *outminute = (_t / 10000) % 100;
-    if (outsecond) *outsecond = (_t / 100) % 100;
+    unsigned long _t = fix.time;
+    if (outyear) *outyear = fix.date.year + (fix.date.year > 80 ? 1900 : 2000);
+    if (outmonth) *outmonth = fix.date.month;
+    if (outday) *outday = fix.date.day;
+    if (outhour) *outhour = _t / 360000;
+    if (outminute) *outminute = _t / 6000 % 60;
+    if (outsecond) *outsecond = _t / 100 % 60;
     if (outhundredths) *outhundredths = _t % 100;
   }
 
-  // lat/long in degrees and age of fix in milliseconds
+  // lat/long in degrees * 10^7
+  inline void get_position_e7(long *outlatitude, long *outlongitude) {
+    if (outlatitude) *outlatitude = fix.latitude;
+    if (outlongitude) *outlongitude = fix.longitude;
+  }
+
+  // lat/long in degrees
   inline void get_position(float *outlatitude, float *outlongitude) {
-    if (outlatitude) *outlatitude = latitude;
-    if (outlongitude) *outlongitude = longitude;
+    if (outlatitude)
+      *outlatitude = fix.latitude == GPS_INVALID_ANGLE ? GPS_INVALID_FLOAT : fix.latitude / 10000000.0;
+    if (outlongitude)
+      *outlongitude = fix.longitude == GPS_INVALID_ANGLE ? GPS_INVALID_FLOAT : fix.longitude / 10000000.0;
   }
 
   // altitude in last full GPGGA sentence in centimeters
   inline float get_altitude() {
-    return altitude;
+    return fix.altitude;
   }
 
   // quality of the GPS data from GGA string
   inline int get_quality() {
-    return quality;
+    return fix.quality;
   }
 
   // course in last full GPVTG sentence in degrees
   inline float get_course() {
-    return course;
+    return fix.course;
   }
 
   // speed in last full GPVTG sentence in knots
   inline float get_speed() {
-    return speed;
+    return fix.speed;
   }
 
   // xte in last full GPXTE sentence in meters
   inline float get_xte() {
-    return xte;
+    return fix.xte;
   }
 
+#ifdef GPGST_TERM
+  // 1 sigma position errors in last full GPGST sentence in meters
+  inline void get_accuracy(float *outlatitude, float *outlongitude, float *outaltitude = 0) {
+    if (outlatitude) *outlatitude = fix.latitude_error;
+    if (outlongitude) *outlongitude = fix.longitude_error;
+    if (outaltitude) *outaltitude = fix.altitude_error;
+  }
+#endif
+
+#ifdef GPHDT_TERM
+  // heading in last full GPHDT sentence in degrees
+  inline float get_heading() {
+    return fix.heading;
+  }
+#endif
+
+#ifdef PTNL_PJK_TERM
+  // local grid position in last full PTNL,PJK sentence in centimeters
+  inline void get_grid_position(long *outnorthing, long *outeasting) {
+    if (outnorthing) *outnorthing = fix.northing;
+    if (outeasting) *outeasting = fix.easting;
+  }
+#endif
+
   //-------------------
   //special conversions
   //-------------------
 
   // altitude in centimeters
   inline int get_altitude_cm(){
-    return int(altitude * 100);
+    return int(fix.altitude * 100);
   }
 
   // speed in miles per hour
   inline float get_speed_mph() {
-    return GPS_MPH_PER_KNOT * speed;
+    return GPS_MPH_PER_KNOT * fix.speed;
   }
 
   // speed in meters per second
   inline float get_speed_ms() {
-    return GPS_MS_PER_KNOT * speed;
+    return GPS_MS_PER_KNOT * fix.speed;
   }
 
   // speed in kilometers per hour
   inline float get_speed_kmh() {
-    return GPS_KMH_PER_KNOT * speed;
+    return GPS_KMH_PER_KNOT * fix.speed;
   }
 
   // cross track error in centimeters
   inline int get_xte_cm() {
-    return xte * 100;
+    return fix.xte * 100;
   }
   
   //-----------
   //age & usage
   //-----------
   
-  //returns age of sentence
+  //returns age of sentence in milliseconds
   inline unsigned long get_GGA_fix_age(){
-    return last_GGA_fix;
+    return millis() - fix.last_GGA_fix;
   }
 
-  //returns age of sentence
+  //returns age of sentence in milliseconds
   inline unsigned long get_VTG_fix_age(){
-    return last_VTG_fix;
+    return millis() - fix.last_VTG_fix;
   }
 
-  //returns age of sentence
+  //returns age of sentence in milliseconds
   inline unsigned long get_XTE_fix_age(){
-    return last_XTE_fix;
+    return millis() - fix.last_XTE_fix;
   }
   
+  //returns age of epoch in milliseconds
+  inline unsigned long get_epoch_fix_age(){
+    return millis() - fix.last_epoch;
+  }
+
   //returns true if data has not been used
   inline boolean got_new_GGA_data(){
     boolean new_data  = new_GGA_data;
@@ -263,6 +773,13 @@ public:
     return new_data;
   }
 
+  //returns true if all sentences of a new epoch arrived
+  inline boolean got_new_epoch_data(){
+    boolean new_data  = new_epoch_data;
+    new_epoch_data = false;
+    return new_data;
+  }
+
   // library version
   inline static float library_version() {
     return GPS_VERSION;
@@ -0,0 +1,87 @@
+/*
+  FarmGPSConfig - build options of the FarmGPS library.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The library sources are compiled apart from the sketch, so a #define in the
+// sketch does not reach them and leaves the sketch with another class layout.
+// Change the options here, or pass them to every file as build flags, e.g.
+// a speed sensor node parsing VTG only (PlatformIO):
+//   build_flags = -DGPS_SENTENCES=GPS_SENTENCE_VTG -DGPS_NO_STATS -DGPS_NO_TRIMBLE
+
+#ifndef FarmGPSConfig_h
+#define FarmGPSConfig_h
+
+// GPS_SENTENCE_* flags of the sentences to parse, others are skipped unparsed
+// Each of GST, RMC, HDT and PJK adds its fields to the fix
+// RMC updates the GGA time and position and the VTG speed and course
+#ifndef GPS_SENTENCES
+#define GPS_SENTENCES (GPS_SENTENCE_GGA | GPS_SENTENCE_VTG | GPS_SENTENCE_XTE | GPS_SENTENCE_ROXTE)
+#endif
+
+#if !((GPS_SENTENCES) & 0x00FF) || ((GPS_SENTENCES) & ~0x00FF)
+#error "GPS_SENTENCES selects no or unknown sentences"
+#endif
+
+// protocols besides NMEA, define to compile out
+//#define GPS_NO_TRIMBLE
+
+// define to compile out the statistics
+//#define GPS_NO_STATS
+
+// high resolution stamp of the sentence start in GpsFix::last_stamp, define as
+// micros() or e.g. a timer capturing the PPS pulse
+//#define GPS_STAMP_CLOCK() micros()
+
+// sentence starts FarmGPSSerial keeps arrival stamps for until process()
+// decodes them, one more than a burst of sentences waiting in the ring
+#ifndef GPS_SERIAL_STARTS
+#define GPS_SERIAL_STARTS 4
+#endif
+
+// profiling of decode(), define to measure the parser cost on target
+// counts cpu cycles on Cortex-M3/M4/M7, microseconds elsewhere
+//#define GPS_PROFILE
+
+// sentences to parse, derived from GPS_SENTENCES
+// only the sentence formatter is matched, the talker id (GP, GN, GL, ...) is ignored
+#if (GPS_SENTENCES) & GPS_SENTENCE_GGA
+#define GPGGA_TERM   "GPGGA"
+#endif
+#if (GPS_SENTENCES) & GPS_SENTENCE_VTG
+#define GPVTG_TERM   "GPVTG"
+#endif
+#if (GPS_SENTENCES) & GPS_SENTENCE_XTE
+#define GPXTE_TERM   "GPXTE"
+#endif
+#if (GPS_SENTENCES) & GPS_SENTENCE_ROXTE
+#define ROXTE_TERM   "ROXTE"
+#endif
+#if (GPS_SENTENCES) & GPS_SENTENCE_GST
+#define GPGST_TERM   "GPGST"
+#endif
+#if (GPS_SENTENCES) & GPS_SENTENCE_RMC
+#define GPRMC_TERM   "GPRMC"
+#endif
+#if (GPS_SENTENCES) & GPS_SENTENCE_HDT
+#define GPHDT_TERM   "GPHDT"
+#endif
+#if (GPS_SENTENCES) & GPS_SENTENCE_PJK
+#define PTNL_PJK_TERM "PTNL,PJK"
+#endif
+
+#endif
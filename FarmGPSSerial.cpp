@@ -0,0 +1,128 @@
+/*
+  FarmGPSSerial - interrupt driven serial ingestion for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FarmGPSSerial.h"
+
+//------------
+// Constructor
+//------------
+
+FarmGPSSerial::FarmGPSSerial(FarmGPS &_gps, byte *_buffer, unsigned int _size) : gps(_gps) {
+  port = 0;
+  buffer = _buffer;
+  size = _size;
+  head = 0;
+  tail = 0;
+
+  start_head = 0;
+  start_tail = 0;
+
+  high_water = 0;
+  overrun_count = 0;
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+void FarmGPSSerial::attach(Stream &_port) {
+  port = &_port;
+}
+
+//Empties the serial port receive buffer into the ring
+void FarmGPSSerial::receive() {
+  if (!port)
+    return;
+  while (port->available() > 0)
+    store(port->read());
+}
+
+//Decodes the ring in contiguous spans, head and tail are 16 bits so
+//they are exchanged with the interrupt with interrupts disabled.
+//A span ends before each sentence start with stamps, so they are given to
+//the decoder right before it. Starts beyond GPS_SERIAL_STARTS get decode stamps
+unsigned int FarmGPSSerial::process(unsigned int max_chars) {
+  unsigned int completed = 0;
+
+  noInterrupts();
+  unsigned int _head = head;
+  byte _start_head = start_head;
+  interrupts();
+  unsigned int _tail = tail;
+  byte _start_tail = start_tail;
+
+  while (_tail != _head && max_chars > 0) {
+    // starts in ring order, the first one waiting is at or after the tail
+    bool _start = _start_tail != _start_head;
+    unsigned int _start_index = _start ? starts[_start_tail].index : 0;
+    if (_start && _tail == _start_index) {
+      volatile Start &_s = starts[_start_tail];
+#ifdef GPS_STAMP_CLOCK
+      gps.set_start(_s.millis, _s.stamp);
+#else
+      gps.set_start(_s.millis);
+#endif
+      if (++_start_tail == GPS_SERIAL_STARTS)
+        _start_tail = 0;
+      _start = _start_tail != _start_head;
+      _start_index = _start ? starts[_start_tail].index : 0;
+    }
+
+    unsigned int span = (_head > _tail ? _head : size) - _tail;
+    if (span > max_chars)
+      span = max_chars;
+    if (_start && _start_index > _tail && _start_index - _tail < span)
+      span = _start_index - _tail;
+
+    completed |= gps.decode_buffer((const char *)buffer + _tail, span);
+
+    _tail += span;
+    if (_tail == size)
+      _tail = 0;
+    max_chars -= span;
+  }
+
+  noInterrupts();
+  tail = _tail;
+  start_tail = _start_tail;
+  interrupts();
+  return completed;
+}
+
+unsigned int FarmGPSSerial::available() {
+  noInterrupts();
+  unsigned int _head = head;
+  unsigned int _tail = tail;
+  interrupts();
+  return _head >= _tail ? _head - _tail : _head + size - _tail;
+}
+
+unsigned int FarmGPSSerial::high_water_mark() {
+  noInterrupts();
+  unsigned int _high_water = high_water;
+  interrupts();
+  return _high_water;
+}
+
+unsigned long FarmGPSSerial::overruns() {
+  noInterrupts();
+  unsigned long _overruns = overrun_count;
+  interrupts();
+  return _overruns;
+}
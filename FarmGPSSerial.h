@@ -0,0 +1,128 @@
+/*
+  FarmGPSSerial - interrupt driven serial ingestion for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FarmGPSSerial_h
+#define FarmGPSSerial_h
+
+#include "FarmGPS.h"
+
+// Ring buffer between a UART and a FarmGPS decoder.
+// store() or receive() fill the ring from an interrupt, a timer or serialEvent(),
+// e.g. on ESP32: Serial1.onReceive([]() { gps_serial.receive(); });
+// process() decodes the ring in bounded slices from the loop, with the sentence
+// start stamps taken by store() at arrival.
+// To decode in the interrupt instead, call FarmGPS::decode() there and
+// read the fix with FarmGPS::read_fix().
+class FarmGPSSerial {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  FarmGPS &gps;
+  Stream *port;
+
+  // ring buffer provided by the sketch, holds size - 1 characters
+  byte *buffer;
+  unsigned int size;
+  volatile unsigned int head;
+  volatile unsigned int tail;
+
+  // arrival of the sentence starts waiting in the ring, in ring order, handed
+  // to the decoder by process(); store() adds at start_head, process() takes
+  // at start_tail, starts beyond GPS_SERIAL_STARTS get decode stamps
+  struct Start {
+    unsigned int index;
+    unsigned long millis;
+#ifdef GPS_STAMP_CLOCK
+    unsigned long stamp;
+#endif
+  };
+  volatile Start starts[GPS_SERIAL_STARTS];
+  volatile byte start_head;
+  volatile byte start_tail;
+
+  // usage monitoring
+  volatile unsigned int high_water;
+  volatile unsigned long overrun_count;
+
+public:
+  //--------------------------------------------------------
+  //public member functions implemented in FarmGPSSerial.cpp
+  //--------------------------------------------------------
+
+  //Constructor
+  FarmGPSSerial(FarmGPS &gps, byte *buffer, unsigned int size);
+
+  // Serial port read by receive()
+  void attach(Stream &port);
+
+  // Moves all characters available on the attached port into the ring
+  void receive();
+
+  // Decodes at most max_chars characters from the ring
+  // Returns GPS_SENTENCE_* flags of the sentences validated
+  unsigned int process(unsigned int max_chars = 0xFFFF);
+
+  //------------------------------
+  //public inline member functions
+  //------------------------------
+
+  // Stores a received character, safe to call from the UART interrupt
+  inline void store(char c) {
+    unsigned int next = head + 1;
+    if (next == size)
+      next = 0;
+    if (next == tail) {
+      overrun_count++;
+      return;
+    }
+    buffer[head] = c;
+    if (c == '$' || c == '@' || byte(c) == GPS_TRIMBLE_START) {
+      byte next_start = start_head + 1;
+      if (next_start == GPS_SERIAL_STARTS)
+        next_start = 0;
+      if (next_start != start_tail) {
+        volatile Start &s = starts[start_head];
+        s.index = head;
+        s.millis = millis();
+#ifdef GPS_STAMP_CLOCK
+        s.stamp = GPS_STAMP_CLOCK();
+#endif
+        start_head = next_start;
+      }
+    }
+    head = next;
+
+    unsigned int used = next >= tail ? next - tail : next + size - tail;
+    if (used > high_water)
+      high_water = used;
+  }
+
+  // number of characters waiting in the ring
+  unsigned int available();
+
+  // highest number of characters waiting in the ring since start
+  unsigned int high_water_mark();
+
+  // number of characters lost because the ring was full
+  unsigned long overruns();
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+  FarmGuidance - cross track error against an A-B line for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FarmGuidance.h"
+
+//------------
+// Constructor
+//------------
+
+FarmGuidance::FarmGuidance() {
+  direction_east = 0;
+  direction_north = 1;
+  line_heading = 0;
+  has_line = false;
+
+  xte = GPS_INVALID_FLOAT;
+  along = GPS_INVALID_FLOAT;
+  heading_error = GPS_INVALID_FLOAT;
+  last_update = 0;
+  new_data = false;
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+void FarmGuidance::set_ab_line(long latitude_a, long longitude_a, long latitude_b, long longitude_b) {
+  // checks the direction before the line changes
+  GeoReference _origin(latitude_a, longitude_a);
+  float east, north;
+  _origin.to_local(latitude_b, longitude_b, &east, &north);
+  float length = sqrt(east * east + north * north);
+  if (length <= 0)
+    return;
+
+  origin = _origin;
+  direction_east = east / length;
+  direction_north = north / length;
+  line_heading = degrees(atan2(direction_east, direction_north));
+  if (line_heading < 0)
+    line_heading += 360;
+  has_line = true;
+}
+
+void FarmGuidance::set_ab_line(long latitude_a, long longitude_a, float heading) {
+  origin.set(latitude_a, longitude_a);
+
+  direction_east = sin(radians(heading));
+  direction_north = cos(radians(heading));
+  line_heading = heading;
+  has_line = true;
+}
+
+void FarmGuidance::update(long latitude, long longitude, float course) {
+  if (!has_line || latitude == GPS_INVALID_ANGLE)
+    return;
+
+  float east, north;
+  origin.to_local(latitude, longitude, &east, &north);
+
+  // projections on the right hand normal and on the line direction
+  xte = east * direction_north - north * direction_east;
+  along = east * direction_east + north * direction_north;
+
+  if (course == GPS_INVALID_FLOAT) {
+    heading_error = GPS_INVALID_FLOAT;
+  }
+  else {
+    heading_error = course - line_heading;
+    if (heading_error > 180)
+      heading_error -= 360;
+    else if (heading_error < -180)
+      heading_error += 360;
+  }
+
+  last_update = millis();
+  new_data = true;
+}
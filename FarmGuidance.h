@@ -0,0 +1,118 @@
+/*
+  FarmGuidance - cross track error against an A-B line for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FarmGuidance_h
+#define FarmGuidance_h
+
+#include "FarmGPS.h"
+#include "GeoReference.h"
+
+// Guidance against an A-B line in the local tangent plane of point A.
+// Call update() for every GGA, e.g. from the FarmGPS callback:
+//   void on_fix(FarmGPS &gps, unsigned int sentence, const GpsFix &fix) {
+//     if (sentence == GPS_SENTENCE_GGA) guidance.update(fix);
+//   }
+// Cross track error is positive right of the line looking from A to B.
+class FarmGuidance {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  // point A and the unit vector from A to B in east/north meters
+  GeoReference origin;
+  float direction_east;
+  float direction_north;
+  float line_heading;
+  bool has_line;
+
+  // results of the last update
+  float xte;
+  float along;
+  float heading_error;
+  unsigned long last_update;
+  bool new_data;
+
+public:
+  //--------------------------------------------------------
+  //public member functions implemented in FarmGuidance.cpp
+  //--------------------------------------------------------
+
+  //Constructor
+  FarmGuidance();
+
+  // Defines the line through A and B, positions in degrees * 10^7, the line
+  // stays as it was when A and B coincide
+  void set_ab_line(long latitude_a, long longitude_a, long latitude_b, long longitude_b);
+
+  // Defines the line through A with a heading in degrees
+  void set_ab_line(long latitude_a, long longitude_a, float heading);
+
+  // Computes cross track error, distance along and heading error for a position
+  // and course in degrees, course GPS_INVALID_FLOAT gives no heading error
+  void update(long latitude, long longitude, float course);
+
+  // Same for the GGA position and latest VTG course of a committed fix
+  inline void update(const GpsFix &fix) {
+    update(fix.latitude, fix.longitude, fix.course);
+  }
+
+  //------------------------------
+  //public inline member functions
+  //------------------------------
+
+  // cross track error in meters, positive right of the line
+  inline float get_xte() {
+    return xte;
+  }
+
+  // cross track error in centimeters
+  inline int get_xte_cm() {
+    return xte * 100;
+  }
+
+  // distance from A along the line in meters
+  inline float get_distance_along() {
+    return along;
+  }
+
+  // course minus line heading in degrees, -180 to 180
+  inline float get_heading_error() {
+    return heading_error;
+  }
+
+  // heading of the line from A to B in degrees
+  inline float get_line_heading() {
+    return line_heading;
+  }
+
+  //returns age of the last update in milliseconds
+  inline unsigned long get_update_age() {
+    return millis() - last_update;
+  }
+
+  //returns true if data has not been used
+  inline boolean got_new_data() {
+    boolean _new_data = new_data;
+    new_data = false;
+    return _new_data;
+  }
+};
+
+#endif
@@ -0,0 +1,219 @@
+/*
+  FieldBoundary - field boundary containment and edge distance for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FieldBoundary.h"
+
+//------------
+// Constructor
+//------------
+
+FieldBoundary::FieldBoundary(const long *_latitudes, const long *_longitudes, unsigned int _count,
+  uint16_t *_index, unsigned int index_size, const unsigned int *_ring_ends, unsigned int _rings) {
+  latitudes = _latitudes;
+  longitudes = _longitudes;
+  count = _count;
+  ring_ends = _ring_ends;
+  rings = _ring_ends ? _rings : 1;
+  index = _index;
+  strips = 0;
+  north_min = 0;
+  strip_height = 1;
+  range = GPS_INVALID_FLOAT;
+
+  inside = false;
+  edge_distance = GPS_INVALID_FLOAT;
+  last_update = 0;
+  new_data = false;
+
+  if (count < 3 || count > 0xFFFF)
+    return;
+  reference.set(latitudes[0], longitudes[0]);
+
+  // about two edges per strip, fewer strips until the index fits
+  unsigned int _strips = count / 2 + 1;
+  while (_strips > 0 && !build(_strips, index_size))
+    _strips = _strips * 2 / 3;
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+// Edges run from a vertex to the next, the last of a ring closes it
+void FieldBoundary::edge(unsigned int number, float *east1, float *north1, float *east2, float *north2) const {
+  unsigned int _next = number + 1;
+  unsigned int _start = 0;
+  for (unsigned int i = 0; i < rings; i++) {
+    unsigned int _end = ring_ends ? ring_ends[i] : count;
+    if (number < _end) {
+      if (_next == _end)
+        _next = _start;
+      break;
+    }
+    _start = _end;
+  }
+  reference.to_local(latitudes[number], longitudes[number], east1, north1);
+  reference.to_local(latitudes[_next], longitudes[_next], east2, north2);
+}
+
+unsigned int FieldBoundary::strip_of(float north) const {
+  float _strip = (north - north_min) / strip_height;
+  if (_strip < 0)
+    return 0;
+  if (_strip >= strips)
+    return strips - 1;
+  return (unsigned int)_strip;
+}
+
+bool FieldBoundary::build(unsigned int _strips, unsigned int size) {
+  if (size < _strips + 1)
+    return false;
+
+  float _min = 0, _max = 0;
+  for (unsigned int i = 0; i < count; i++) {
+    float north;
+    reference.to_local(latitudes[i], longitudes[i], 0, &north);
+    if (north < _min) _min = north;
+    if (north > _max) _max = north;
+  }
+  strips = _strips;
+  north_min = _min;
+  strip_height = _max > _min ? (_max - _min) / _strips : 1;
+
+  // edges per strip in index[1..strips], stop when the index is full
+  for (unsigned int j = 0; j <= strips; j++)
+    index[j] = 0;
+  unsigned long _entries = 0;
+  for (unsigned int i = 0; i < count; i++) {
+    float e1, n1, e2, n2;
+    edge(i, &e1, &n1, &e2, &n2);
+    unsigned int _first = strip_of(n1 < n2 ? n1 : n2), _last = strip_of(n1 < n2 ? n2 : n1);
+    _entries += _last - _first + 1;
+    if (strips + 1 + _entries > size || strips + 1 + _entries > 0xFFFF) {
+      strips = 0;
+      return false;
+    }
+    for (unsigned int j = _first; j <= _last; j++)
+      index[j + 1]++;
+  }
+
+  // start offsets, then the edge numbers with index[j] as cursor of strip j
+  index[0] = strips + 1;
+  for (unsigned int j = 1; j <= strips; j++)
+    index[j] += index[j - 1];
+  for (unsigned int j = strips; j > 0; j--)
+    index[j] = index[j - 1];
+  for (unsigned int i = 0; i < count; i++) {
+    float e1, n1, e2, n2;
+    edge(i, &e1, &n1, &e2, &n2);
+    unsigned int _first = strip_of(n1 < n2 ? n1 : n2), _last = strip_of(n1 < n2 ? n2 : n1);
+    for (unsigned int j = _first; j <= _last; j++)
+      index[index[j + 1]++] = i;
+  }
+  index[0] = strips + 1;
+  return true;
+}
+
+// Distance from a point to the segment between two points
+static float segment_distance(float east, float north, float e1, float n1, float e2, float n2) {
+  float de = e2 - e1, dn = n2 - n1;
+  float _length = de * de + dn * dn;
+  float t = _length > 0 ? ((east - e1) * de + (north - n1) * dn) / _length : 0;
+  if (t < 0)
+    t = 0;
+  else if (t > 1)
+    t = 1;
+  float ee = e1 + t * de - east, en = n1 + t * dn - north;
+  return sqrt(ee * ee + en * en);
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+//Casts a ray east and counts the edges it crosses, only edges of its strip can
+bool FieldBoundary::contains(long latitude, long longitude) const {
+  if (!strips || latitude == GPS_INVALID_ANGLE)
+    return false;
+
+  float east, north;
+  reference.to_local(latitude, longitude, &east, &north);
+  if (north < north_min || north > north_min + strips * strip_height)
+    return false;
+
+  unsigned int j = strip_of(north);
+  bool _inside = false;
+  for (unsigned int k = index[j]; k < index[j + 1]; k++) {
+    float e1, n1, e2, n2;
+    edge(index[k], &e1, &n1, &e2, &n2);
+    if ((n1 > north) != (n2 > north) && east < e1 + (north - n1) * (e2 - e1) / (n2 - n1))
+      _inside = !_inside;
+  }
+  return _inside;
+}
+
+//Searches the strips outward from the position until the next strip is
+//farther away than the nearest edge found or the range
+float FieldBoundary::distance_to_edge(long latitude, long longitude, float range) const {
+  if (!strips || latitude == GPS_INVALID_ANGLE)
+    return GPS_INVALID_FLOAT;
+
+  float east, north;
+  reference.to_local(latitude, longitude, &east, &north);
+
+  float _nearest = range;
+  unsigned int j = strip_of(north);
+  for (unsigned int step = 0; step < strips; step++) {
+    bool _searched = false;
+    for (byte side = 0; side < 2; side++) {
+      if (side && !step)
+        break;
+      long s = side ? long(j) - long(step) : long(j) + long(step);
+      if (s < 0 || s >= long(strips))
+        continue;
+
+      // north distance to the strip
+      float _low = north_min + s * strip_height, _high = _low + strip_height;
+      float _gap = north < _low ? _low - north : north > _high ? north - _high : 0;
+      if (_gap > _nearest)
+        continue;
+      _searched = true;
+      for (unsigned int k = index[s]; k < index[s + 1]; k++) {
+        float e1, n1, e2, n2;
+        edge(index[k], &e1, &n1, &e2, &n2);
+        float _distance = segment_distance(east, north, e1, n1, e2, n2);
+        if (_distance < _nearest)
+          _nearest = _distance;
+      }
+    }
+    if (!_searched && step > 0)
+      break;
+  }
+  return _nearest < range ? _nearest : GPS_INVALID_FLOAT;
+}
+
+void FieldBoundary::update(long latitude, long longitude, unsigned long time) {
+  if (!strips || latitude == GPS_INVALID_ANGLE)
+    return;
+
+  inside = contains(latitude, longitude);
+  edge_distance = distance_to_edge(latitude, longitude, range);
+  last_update = time;
+  new_data = true;
+}
@@ -0,0 +1,145 @@
+/*
+  FieldBoundary - field boundary containment and edge distance for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FieldBoundary_h
+#define FieldBoundary_h
+
+#include "FarmGPS.h"
+#include "GeoReference.h"
+
+// index words per vertex that give strips of about two edges
+#define FIELD_BOUNDARY_INDEX_PER_VERTEX 3
+
+// Boundary polygon of a field in degrees * 10^7, one or more closed rings,
+// e.g. the outer boundary followed by obstacles; a position is inside when it
+// is within an odd number of rings. The vertex arrays are only read, const
+// arrays stay in flash on ARM and ESP32.
+// The edges are indexed in strips of equal north extent in the tangent plane
+// of the first vertex, in storage provided by the sketch, e.g.
+//   uint16_t boundary_index[FIELD_BOUNDARY_INDEX_PER_VERTEX * 1000];
+//   FieldBoundary boundary(latitudes, longitudes, 1000, boundary_index, 3000);
+// Queries test the edges of one strip, the storage sets the number of strips.
+// Call update() for every GGA, e.g. from the FarmGPS callback:
+//   if (sentence == GPS_SENTENCE_GGA) boundary.update(fix);
+class FieldBoundary {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  const long *latitudes;
+  const long *longitudes;
+  unsigned int count;
+  const unsigned int *ring_ends;  // vertex count at the end of each ring
+  unsigned int rings;
+
+  GeoReference reference;
+
+  // strip index, strips + 1 start offsets followed by the edge numbers
+  uint16_t *index;
+  unsigned int strips;
+  float north_min;
+  float strip_height;
+
+  // meters searched for the nearest edge by update()
+  float range;
+
+  // results of the last update
+  bool inside;
+  float edge_distance;
+  unsigned long last_update;
+  bool new_data;
+
+  //---------------------------------------------------------
+  // private member functions implemented in FieldBoundary.cpp
+  //---------------------------------------------------------
+
+  // Local coordinates of the two vertices of an edge
+  void edge(unsigned int number, float *east1, float *north1, float *east2, float *north2) const;
+
+  // Strip of a north coordinate, clamped to the index
+  unsigned int strip_of(float north) const;
+
+  // Fills the index with the edges of each strip, false when they do not fit
+  bool build(unsigned int strips, unsigned int size);
+
+public:
+  //---------------------------------------------------------
+  //public member functions implemented in FieldBoundary.cpp
+  //---------------------------------------------------------
+
+  //Constructor, a single ring without ring_ends, index_size words of index
+  FieldBoundary(const long *latitudes, const long *longitudes, unsigned int count,
+    uint16_t *index, unsigned int index_size, const unsigned int *ring_ends = 0, unsigned int rings = 1);
+
+  // True when a position is inside the boundary
+  bool contains(long latitude, long longitude) const;
+
+  // Distance in meters from a position to the nearest edge, GPS_INVALID_FLOAT
+  // when there is none within range. The search time grows with the range
+  // over the strip height, a range of the boom width keeps it short
+  float distance_to_edge(long latitude, long longitude, float range = GPS_INVALID_FLOAT) const;
+
+  // Evaluates the position of a fix, results are read with the getters below
+  void update(long latitude, long longitude, unsigned long time);
+
+  // Same for the GGA position of a committed fix
+  inline void update(const GpsFix &fix) {
+    update(fix.latitude, fix.longitude, fix.last_GGA_fix);
+  }
+
+  //------------------------------
+  //public inline member functions
+  //------------------------------
+
+  // Limits the nearest edge search of update() to meters from the position
+  inline void set_range(float meters) {
+    range = meters;
+  }
+
+  // number of strips of the index, 0 when the boundary did not fit
+  inline unsigned int get_strips() const {
+    return strips;
+  }
+
+  // true when the last position was inside the boundary
+  inline bool get_inside() {
+    return inside;
+  }
+
+  // meters from the last position to the nearest edge, GPS_INVALID_FLOAT before
+  // the first or beyond the range
+  inline float get_edge_distance() {
+    return edge_distance;
+  }
+
+  //returns age of the last update in milliseconds
+  inline unsigned long get_update_age() {
+    return millis() - last_update;
+  }
+
+  //returns true if data has not been used
+  inline boolean got_new_data() {
+    boolean _new_data = new_data;
+    new_data = false;
+    return _new_data;
+  }
+};
+
+#endif
@@ -0,0 +1,153 @@
+/*
+  FixHistory - compact ring buffer of recent GGA fixes for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FixHistory.h"
+
+//------------
+// Constructor
+//------------
+
+FixHistory::FixHistory(FixHistoryEntry *_entries, unsigned int _capacity) {
+  entries = _entries;
+  capacity = _capacity;
+  clear();
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+// Converts meters to rounded centimeters, false when out of 16 bit range
+static bool to_centimeters(float meters, int16_t *out) {
+  float cm = meters * 100;
+  if (cm > 32767 || cm < -32767)
+    return false;
+  *out = int16_t(cm < 0 ? cm - 0.5 : cm + 0.5);
+  return true;
+}
+
+void FixHistory::rebase(long latitude, long longitude) {
+  GeoReference _reference(latitude, longitude);
+
+  // newest entries are nearest to the new reference, stop at the first that does not fit
+  unsigned int kept = 0;
+  for (; kept < count; kept++) {
+    FixHistoryEntry &entry = entries[slot(kept)];
+    long lat, lon;
+    reference.from_local(entry.east / 100.0, entry.north / 100.0, &lat, &lon);
+
+    float east, north;
+    _reference.to_local(lat, lon, &east, &north);
+    if (!to_centimeters(east, &entry.east) || !to_centimeters(north, &entry.north))
+      break;
+  }
+  count = kept;
+  reference = _reference;
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+void FixHistory::add(long latitude, long longitude, unsigned long time, int quality, float speed) {
+  if (!capacity || latitude == GPS_INVALID_ANGLE)
+    return;
+  if (!count)
+    reference.set(latitude, longitude);
+
+  FixHistoryEntry entry;
+  float east, north;
+  reference.to_local(latitude, longitude, &east, &north);
+  if (!to_centimeters(east, &entry.east) || !to_centimeters(north, &entry.north)) {
+    rebase(latitude, longitude);
+    entry.east = entry.north = 0;
+  }
+
+  unsigned int _speed = 0;
+  if (speed != GPS_INVALID_FLOAT) {
+    float cm_per_second = speed * GPS_MS_PER_KNOT * 100;
+    _speed = cm_per_second > 0x1FFF ? 0x1FFF : (unsigned int)cm_per_second;
+  }
+  if (quality > 7)
+    quality = 7;
+  else if (quality < 0)
+    quality = 0;
+
+  // the age of the oldest entries would wrap in 16 bits
+  unsigned long _gap = time / 10 - newest_time / 10;
+  while (count && _gap + age(count - 1) > 0xFFFF)
+    count--;
+
+  entry.time = time / 10;
+  entry.status = (quality << 13) | _speed;
+  newest_time = time;
+
+  entries[head] = entry;
+  head = (head + 1) % capacity;
+  if (count < capacity)
+    count++;
+}
+
+bool FixHistory::get(unsigned int index, FixHistoryPoint &point) const {
+  if (index >= count)
+    return false;
+
+  const FixHistoryEntry &entry = entries[slot(index)];
+  reference.from_local(entry.east / 100.0, entry.north / 100.0, &point.latitude, &point.longitude);
+  point.time = (newest_time / 10 - age(index)) * 10;
+  point.quality = entry.status >> 13;
+  point.speed = (entry.status & 0x1FFF) / 100.0;
+  return true;
+}
+
+//Estimates the index from the mean interval between entries, then walks to
+//the nearest entry, a few steps when fixes arrive at a steady rate. Ages are
+//compared in milliseconds to the entry times of get()
+int FixHistory::nearest(unsigned long time) const {
+  if (!count)
+    return -1;
+
+  long _age = long(newest_time / 10 * 10 - time);
+  if (_age <= 0 || count == 1)
+    return 0;
+
+  unsigned long span = age(count - 1);
+  unsigned int index = count - 1;
+  if ((unsigned long)_age < span * 10) {
+    index = _age / 10 * (count - 1) / span;
+    while (index + 1 < count && age(index + 1) * 10L <= _age)
+      index++;
+    while (index > 0 && age(index) * 10L > _age)
+      index--;
+  }
+  // the newest of entries with the same time
+  while (index > 0 && age(index - 1) == age(index))
+    index--;
+
+  // index is at or before the time, the next entry after it
+  if (index + 1 < count && age(index + 1) * 10L - _age < _age - age(index) * 10L)
+    index++;
+  return index;
+}
+
+void FixHistory::clear() {
+  head = 0;
+  count = 0;
+  newest_time = 0;
+}
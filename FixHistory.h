@@ -0,0 +1,152 @@
+/*
+  FixHistory - compact ring buffer of recent GGA fixes for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FixHistory_h
+#define FixHistory_h
+
+#include "FarmGPS.h"
+#include "GeoReference.h"
+
+// stored entry, 8 bytes
+struct FixHistoryEntry {
+  int16_t north;      // centimeters north of the history reference
+  int16_t east;       // centimeters east of the history reference
+  uint16_t time;      // millis() / 10, wraps after 655 seconds
+  uint16_t status;    // quality in the upper 3 bits, speed in cm/s in the lower 13
+};
+
+// decoded entry
+struct FixHistoryPoint {
+  long latitude;        // degrees * 10^7
+  long longitude;       // degrees * 10^7
+  unsigned long time;   // millis() to 10 milliseconds
+  byte quality;
+  float speed;          // meters per second
+};
+
+// Ring buffer of fixes in storage provided by the sketch, e.g.
+//   FixHistoryEntry entries[300];
+//   FixHistory history(entries, 300);
+// and history.add(fix) from the FarmGPS callback for GPS_SENTENCE_GGA.
+// Positions are stored relative to a reference that moves along when the
+// position gets 327 m away; entries out of reach of the new reference are dropped.
+// Times are kept to 10 ms, entries more than 655 s older than the newest are dropped.
+// Index 0 is the newest entry.
+class FixHistory {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  FixHistoryEntry *entries;
+  unsigned int capacity;
+  unsigned int head;    // slot of the next entry
+  unsigned int count;
+
+  GeoReference reference;
+  unsigned long newest_time;
+
+  //-------------------------------------------------------
+  // private member functions implemented in FixHistory.cpp
+  //-------------------------------------------------------
+
+  // Slot of an entry by index from the newest
+  inline unsigned int slot(unsigned int index) const {
+    return (head + capacity - 1 - index) % capacity;
+  }
+
+  // Age in centiseconds of an entry relative to the newest
+  inline uint16_t age(unsigned int index) const {
+    return entries[slot(0)].time - entries[slot(index)].time;
+  }
+
+  // Moves the reference to a position, drops entries that do not fit
+  void rebase(long latitude, long longitude);
+
+public:
+  //------------------------------------------------------
+  //public member functions implemented in FixHistory.cpp
+  //------------------------------------------------------
+
+  //Constructor
+  FixHistory(FixHistoryEntry *entries, unsigned int capacity);
+
+  // Adds a position in degrees * 10^7 at a millis() time, speed in knots
+  void add(long latitude, long longitude, unsigned long time, int quality, float speed);
+
+  // Adds the GGA position of a committed fix
+  inline void add(const GpsFix &fix) {
+    add(fix.latitude, fix.longitude, fix.last_GGA_fix, fix.quality, fix.speed);
+  }
+
+  // Decodes an entry, returns false when there is no such entry
+  bool get(unsigned int index, FixHistoryPoint &point) const;
+
+  // Index of the entry nearest to a millis() time, the newer of two as near,
+  // -1 when empty
+  int nearest(unsigned long time) const;
+
+  // Removes all entries
+  void clear();
+
+  //------------------------------
+  //public inline member functions
+  //------------------------------
+
+  // number of entries
+  inline unsigned int size() const {
+    return count;
+  }
+
+  // iterates from newest to oldest entry
+  class Iterator {
+  private:
+    const FixHistory *history;
+    unsigned int index;
+
+  public:
+    inline Iterator(const FixHistory *_history, unsigned int _index) : history(_history), index(_index) {
+    }
+
+    inline FixHistoryPoint operator*() const {
+      FixHistoryPoint point;
+      history->get(index, point);
+      return point;
+    }
+
+    inline Iterator &operator++() {
+      index++;
+      return *this;
+    }
+
+    inline bool operator!=(const Iterator &other) const {
+      return index != other.index;
+    }
+  };
+
+  inline Iterator begin() const {
+    return Iterator(this, 0);
+  }
+
+  inline Iterator end() const {
+    return Iterator(this, count);
+  }
+};
+
+#endif
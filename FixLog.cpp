@@ -0,0 +1,377 @@
+/*
+  FixLog - columnar fix file writer and reader for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FixLog.h"
+
+//-------------------------
+// encoding, 32 bit values
+//-------------------------
+
+static void to_columns(const FixLogRecord &record, uint32_t *values) {
+  values[0] = record.time;
+  values[1] = record.latitude;
+  values[2] = record.longitude;
+  values[3] = record.speed;
+  values[4] = record.course;
+  values[5] = record.xte;
+  values[6] = record.quality;
+}
+
+static void from_columns(const uint32_t *values, FixLogRecord &record) {
+  record.time = values[0];
+  record.latitude = int32_t(values[1]);
+  record.longitude = int32_t(values[2]);
+  record.speed = int32_t(values[3]);
+  record.course = int32_t(values[4]);
+  record.xte = int32_t(values[5]);
+  record.quality = values[6];
+}
+
+// Writes 7 bits per byte, low bits first, returns the length of 1 to 5 bytes
+static byte put_varint(byte *out, uint32_t value) {
+  byte n = 0;
+  while (value >= 0x80) {
+    out[n++] = value | 0x80;
+    value >>= 7;
+  }
+  out[n++] = value;
+  return n;
+}
+
+// Reads a varint ending before end, false when it does not
+static bool get_varint(const byte *&in, const byte *end, uint32_t &value) {
+  value = 0;
+  for (byte shift = 0; shift < 35 && in < end; shift += 7) {
+    byte b = *in++;
+    value |= uint32_t(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+// Writes the zigzag varint of the difference of two values
+static byte put_delta(byte *out, uint32_t value, uint32_t previous) {
+  int32_t _delta = int32_t(value - previous);
+  return put_varint(out, (uint32_t(_delta) << 1) ^ uint32_t(_delta >> 31));
+}
+
+// Reads a zigzag varint difference from a column ending before end and adds
+// it to value, false when the column ends first
+static bool get_delta(const byte *&in, const byte *end, uint32_t &value) {
+  uint32_t _zigzag;
+  if (!get_varint(in, end, _zigzag))
+    return false;
+  value += (_zigzag >> 1) ^ (0 - (_zigzag & 1));
+  return true;
+}
+
+static void put_32(byte *out, uint32_t value) {
+  for (byte i = 0; i < 4; i++)
+    out[i] = value >> (8 * i);
+}
+
+static uint32_t get_32(const byte *in) {
+  return uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16 | uint32_t(in[3]) << 24;
+}
+
+//------------
+// Constructor
+//------------
+
+FixLogWriter::FixLogWriter(byte *_buffer, unsigned int _size, FixLogSink _sink, void *_context) {
+  sink = _sink;
+  context = _context;
+  buffer = _buffer;
+  column_size = _size / FIX_LOG_COLUMNS;
+
+  count = 0;
+  for (byte i = 0; i < FIX_LOG_COLUMNS; i++)
+    fill[i] = 0;
+  written = 0;
+  last_index = GPS_INVALID_LONG;
+  indexed = 0;
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+void FixLogWriter::write(const byte *data, unsigned int length) {
+  if (!written) {
+    static const byte header[4] = { 'F', 'X', 'L', FIX_LOG_VERSION };
+    written = sizeof header;
+    sink(header, sizeof header, context);
+  }
+  sink(data, length, context);
+  written += length;
+}
+
+void FixLogWriter::write_index() {
+  unsigned long _offset = written;
+  byte _head[2] = { 'I', indexed };
+  write(_head, 2);
+  for (byte i = 0; i < indexed; i++) {
+    byte _entry[12];
+    put_32(_entry, index_offset[i]);
+    put_32(_entry + 4, index_first[i]);
+    put_32(_entry + 8, index_last[i]);
+    write(_entry, sizeof _entry);
+  }
+  byte _previous[4];
+  put_32(_previous, last_index);
+  write(_previous, 4);
+  last_index = _offset;
+  indexed = 0;
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+void FixLogWriter::add(const FixLogRecord &record) {
+  if (column_size < 5)
+    return;
+  if (count == 0xFF)
+    flush();
+  for (byte i = 0; i < FIX_LOG_COLUMNS; i++) {
+    if (column_size - fill[i] < 5) {
+      flush();
+      break;
+    }
+  }
+
+  uint32_t _values[FIX_LOG_COLUMNS];
+  to_columns(record, _values);
+  if (!count) {
+    for (byte i = 0; i < FIX_LOG_COLUMNS; i++)
+      last[i] = 0;
+    first_time = last_time = GPS_INVALID_LONG;
+  }
+  for (byte i = 0; i < FIX_LOG_COLUMNS; i++) {
+    fill[i] += put_delta(buffer + i * column_size + fill[i], _values[i], last[i]);
+    last[i] = _values[i];
+  }
+  if (record.time != GPS_INVALID_LONG) {
+    if (first_time == GPS_INVALID_LONG)
+      first_time = record.time;
+    last_time = record.time;
+  }
+  count++;
+}
+
+void FixLogWriter::add(const GpsFix &fix) {
+  FixLogRecord _record;
+  _record.time = fix.time;
+  _record.latitude = fix.latitude;
+  _record.longitude = fix.longitude;
+  _record.speed = fix.speed == GPS_INVALID_FLOAT ? FIX_LOG_INVALID : long(fix.speed * GPS_MS_PER_KNOT * 100);
+  _record.course = fix.course == GPS_INVALID_FLOAT ? FIX_LOG_INVALID : long(fix.course * 100);
+  _record.xte = fix.xte == GPS_INVALID_FLOAT ? FIX_LOG_INVALID : long(fix.xte * 100);
+  _record.quality = fix.quality;
+  add(_record);
+}
+
+void FixLogWriter::flush() {
+  if (!count)
+    return;
+
+  byte _head[2 + 8 + FIX_LOG_COLUMNS * 3];
+  byte n = 0;
+  _head[n++] = 'B';
+  _head[n++] = count;
+  put_32(_head + n, first_time);
+  put_32(_head + n + 4, last_time);
+  n += 8;
+  for (byte i = 0; i < FIX_LOG_COLUMNS; i++)
+    n += put_varint(_head + n, fill[i]);
+
+  // write() puts the file header ahead of the first block
+  index_offset[indexed] = written ? written : 4;
+  index_first[indexed] = first_time;
+  index_last[indexed] = last_time;
+  write(_head, n);
+  for (byte i = 0; i < FIX_LOG_COLUMNS; i++) {
+    write(buffer + i * column_size, fill[i]);
+    fill[i] = 0;
+  }
+  count = 0;
+
+  if (++indexed == FIX_LOG_INDEX)
+    write_index();
+}
+
+void FixLogWriter::close() {
+  flush();
+  if (indexed)
+    write_index();
+  byte _end[5] = { 'E' };
+  put_32(_end + 1, last_index);
+  write(_end, sizeof _end);
+}
+
+//------------
+// Constructor
+//------------
+
+FixLogReader::FixLogReader(const byte *_data, unsigned long _length) {
+  data = _data;
+  length = _length;
+  rewind();
+}
+
+//----------------------------------------
+// private member functions implementation
+//----------------------------------------
+
+bool FixLogReader::open_block(unsigned long offset) {
+  cursor.remaining = 0;
+  cursor.next_block = length;
+  while (offset < length) {
+    if (data[offset] == 'I') {
+      if (offset + 1 >= length)
+        return false;
+      offset += 2 + data[offset + 1] * 12UL + 4;
+      continue;
+    }
+    if (data[offset] != 'B' || offset + 10 > length)
+      return false;
+
+    // column starts, a block cut off by a power loss ends the file
+    const byte *_in = data + offset + 10;
+    const byte *_end = data + length;
+    uint32_t _lengths[FIX_LOG_COLUMNS];
+    for (byte i = 0; i < FIX_LOG_COLUMNS; i++) {
+      if (!get_varint(_in, _end, _lengths[i]))
+        return false;
+    }
+    unsigned long _left = _end - _in;
+    for (byte i = 0; i < FIX_LOG_COLUMNS; i++) {
+      if (_lengths[i] > _left)
+        return false;
+      _left -= _lengths[i];
+    }
+
+    // every fix takes at least a byte of each column
+    for (byte i = 0; i < FIX_LOG_COLUMNS; i++) {
+      if (_lengths[i] < data[offset + 1])
+        return false;
+      cursor.column[i] = _in;
+      cursor.last[i] = 0;
+      _in += _lengths[i];
+      cursor.column_end[i] = _in;
+    }
+    cursor.remaining = data[offset + 1];
+    cursor.last_time = get_32(data + offset + 6);
+    cursor.next_block = _in - data;
+    return true;
+  }
+  return false;
+}
+
+unsigned long FixLogReader::find_indexed(unsigned long time) {
+  if (length < 4 + 5 || data[length - 5] != 'E')
+    return 0;
+
+  // indexes from the last, entries in file order, blocks without time may hold any
+  unsigned long _found = length;
+  uint32_t _index = get_32(data + length - 4);
+  while (_index < length && length - _index >= 2 && data[_index] == 'I') {
+    byte n = data[_index + 1];
+    const byte *_entry = data + _index + 2;
+    if (length - _index - 2 < n * 12UL + 4)
+      break;
+    for (byte i = n; i > 0; i--) {
+      const byte *_e = _entry + (i - 1) * 12;
+      uint32_t _last = get_32(_e + 8);
+      if (_last != GPS_INVALID_LONG && _last < time)
+        return _found;
+      _found = get_32(_e);
+    }
+    // the previous index is earlier in the file
+    uint32_t _previous = get_32(_entry + n * 12);
+    if (_previous >= _index)
+      break;
+    _index = _previous;
+  }
+  return _found;
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+bool FixLogReader::valid() {
+  return length >= 4 && data[0] == 'F' && data[1] == 'X' && data[2] == 'L' && data[3] == FIX_LOG_VERSION;
+}
+
+void FixLogReader::rewind() {
+  cursor.remaining = 0;
+  cursor.next_block = valid() ? 4 : length;
+}
+
+bool FixLogReader::seek(unsigned long time) {
+  unsigned long _block = find_indexed(time);
+  if (_block == length)
+    return false;
+  if (_block) {
+    cursor.remaining = 0;
+    cursor.next_block = _block;
+  }
+  else {
+    // without index the block headers are scanned, their columns skipped
+    rewind();
+    do {
+      if (!open_block(cursor.next_block))
+        return false;
+    } while (cursor.last_time != GPS_INVALID_LONG && cursor.last_time < time);
+  }
+
+  // skip the fixes of the block before time
+  FixLogRecord _record;
+  Cursor _at = cursor;
+  while (next(_record)) {
+    if (_record.time != GPS_INVALID_LONG && _record.time >= time) {
+      cursor = _at;
+      return true;
+    }
+    _at = cursor;
+  }
+  return false;
+}
+
+bool FixLogReader::next(FixLogRecord &record) {
+  if (!cursor.remaining && !open_block(cursor.next_block))
+    return false;
+
+  // a corrupt column ends the file
+  uint32_t _values[FIX_LOG_COLUMNS];
+  for (byte i = 0; i < FIX_LOG_COLUMNS; i++) {
+    _values[i] = cursor.last[i];
+    if (!get_delta(cursor.column[i], cursor.column_end[i], _values[i])) {
+      cursor.remaining = 0;
+      cursor.next_block = length;
+      return false;
+    }
+    cursor.last[i] = _values[i];
+  }
+  from_columns(_values, record);
+  cursor.remaining--;
+  return true;
+}
@@ -0,0 +1,183 @@
+/*
+  FixLog - columnar fix file writer and reader for FarmGPS.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FixLog_h
+#define FixLog_h
+
+#include "FarmGPS.h"
+
+// Fix file, all numbers little endian:
+//   header  'F' 'X' 'L' version
+//   block   'B' count, 32 bit first and last valid time, 7 varint column lengths,
+//           the columns time, latitude, longitude, speed, course, xte, quality
+//   index   'I' count, per block 32 bit offset, first and last time, 32 bit offset
+//           of the previous index, all ones for none, after every FIX_LOG_INDEX blocks
+//   end     'E' 32 bit offset of the last index, written by close()
+// A column holds the zigzag varint deltas of its values from the previous fix
+// in the block, the first from 0, so each block decodes on its own. Files
+// without end, e.g. after a power loss, are read up to the last whole block.
+#define FIX_LOG_VERSION 1
+#define FIX_LOG_COLUMNS 7
+
+// blocks listed per index, the writer keeps 12 bytes per block
+#ifndef FIX_LOG_INDEX
+#define FIX_LOG_INDEX 8
+#endif
+
+// speed, course or xte unknown
+#define FIX_LOG_INVALID 0x7FFFFFFFL
+
+// smallest writer buffer, 5 bytes per column for the largest varint
+#define FIX_LOG_MIN_BUFFER (FIX_LOG_COLUMNS * 5)
+
+// fix as stored
+struct FixLogRecord {
+  unsigned long time;   // UTC centiseconds since midnight, GPS_INVALID_LONG while unknown
+  long latitude;        // degrees * 10^7, GPS_INVALID_ANGLE while unknown
+  long longitude;       // degrees * 10^7
+  long speed;           // centimeters per second
+  long course;          // centidegrees
+  long xte;             // centimeters
+  byte quality;
+};
+
+// receives the bytes of the file in order, e.g. for an SD card
+//   void write_file(const byte *data, unsigned int length, void *file) {
+//     ((File *)file)->write(data, length);
+//   }
+typedef void (*FixLogSink)(const byte *data, unsigned int length, void *context);
+
+// Streams fixes in blocks to a sink, in a buffer provided by the sketch, e.g.
+//   byte log_buffer[512];
+//   FixLogWriter writer(log_buffer, sizeof log_buffer, write_file, &file);
+// and writer.add(fix) from the FarmGPS callback for GPS_SENTENCE_EPOCH.
+// The buffer is split over the columns and a block is written when a column
+// is full, larger buffers give larger blocks and a smaller index.
+class FixLogWriter {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  FixLogSink sink;
+  void *context;
+
+  // column buffers
+  byte *buffer;
+  unsigned int column_size;
+  unsigned int fill[FIX_LOG_COLUMNS];
+
+  // block being filled
+  byte count;
+  unsigned long first_time;
+  unsigned long last_time;
+  unsigned long last[FIX_LOG_COLUMNS];
+
+  // file position and the blocks not yet written to an index
+  unsigned long written;
+  unsigned long last_index;
+  byte indexed;
+  unsigned long index_offset[FIX_LOG_INDEX];
+  unsigned long index_first[FIX_LOG_INDEX];
+  unsigned long index_last[FIX_LOG_INDEX];
+
+  //---------------------------------------------------
+  // private member functions implemented in FixLog.cpp
+  //---------------------------------------------------
+
+  void write(const byte *data, unsigned int length);
+  void write_index();
+
+public:
+  //--------------------------------------------------
+  //public member functions implemented in FixLog.cpp
+  //--------------------------------------------------
+
+  //Constructor, the buffer holds at least FIX_LOG_MIN_BUFFER bytes
+  FixLogWriter(byte *buffer, unsigned int size, FixLogSink sink, void *context = 0);
+
+  // Adds a fix, writes the block first when it is full
+  void add(const FixLogRecord &record);
+
+  // Adds the committed fields of a fix
+  void add(const GpsFix &fix);
+
+  // Writes the block being filled
+  void flush();
+
+  // Writes the block being filled, the index and the end of the file
+  void close();
+};
+
+// Reads a fix file in memory, e.g. mapped from disk. Reads stay within the
+// data, a corrupt block or column ends the file
+class FixLogReader {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  const byte *data;
+  unsigned long length;
+
+  // decoding position
+  struct Cursor {
+    unsigned long next_block;   // offset of the block after the current one
+    byte remaining;             // fixes left in the current block
+    unsigned long last_time;    // last valid time in the current block
+    const byte *column[FIX_LOG_COLUMNS];
+    const byte *column_end[FIX_LOG_COLUMNS];
+    unsigned long last[FIX_LOG_COLUMNS];
+  } cursor;
+
+  //---------------------------------------------------
+  // private member functions implemented in FixLog.cpp
+  //---------------------------------------------------
+
+  // Starts the block at offset, skips indexes, false at the end
+  bool open_block(unsigned long offset);
+
+  // Offset of the first block ending at or after time from the indexes,
+  // length when there is none, 0 for a file without end
+  unsigned long find_indexed(unsigned long time);
+
+public:
+  //--------------------------------------------------
+  //public member functions implemented in FixLog.cpp
+  //--------------------------------------------------
+
+  //Constructor
+  FixLogReader(const byte *data, unsigned long length);
+
+  // True when the data starts with a fix file header of this version
+  bool valid();
+
+  // Positions at the first fix
+  void rewind();
+
+  // Positions at the first fix at or after a time, for files with increasing
+  // times such as a file per day, using the index when the file has its end.
+  // Returns false when there is none
+  bool seek(unsigned long time);
+
+  // Decodes the next fix, returns false at the end of the file
+  bool next(FixLogRecord &record);
+};
+
+#endif
@@ -0,0 +1,78 @@
+/*
+  GeoReference - a fixed reference point for fast distances and local coordinates.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "GeoReference.h"
+
+//------------
+// Constructor
+//------------
+
+GeoReference::GeoReference() {
+  set(0, 0);
+}
+
+GeoReference::GeoReference(long _latitude, long _longitude) {
+  set(_latitude, _longitude);
+}
+
+//--------------------------------------
+//public member functions implementation
+//--------------------------------------
+
+void GeoReference::set(long _latitude, long _longitude) {
+  latitude = _latitude;
+  longitude = _longitude;
+
+  float lat = radians(latitude / 10000000.0);
+  sin_latitude = sin(lat);
+  cos_latitude = cos(lat);
+
+  north_scale = GPS_METERS_PER_E7;
+  east_scale = GPS_METERS_PER_E7 * cos_latitude;
+}
+
+float GeoReference::distance_to(long lat, long lon) const {
+  // FarmGPS::distance_between() with the trig of the reference taken from the cache
+  float delta = radians((longitude - lon) / 10000000.0);
+  float sdlong = sin(delta);
+  float cdlong = cos(delta);
+  float lat2 = radians(lat / 10000000.0);
+  float slat2 = sin(lat2);
+  float clat2 = cos(lat2);
+  delta = (cos_latitude * slat2) - (sin_latitude * clat2 * cdlong);
+  delta = sq(delta);
+  delta += sq(clat2 * sdlong);
+  delta = sqrt(delta);
+  float denom = (sin_latitude * slat2) + (cos_latitude * clat2 * cdlong);
+  delta = atan2(delta, denom);
+  return delta * GPS_EARTH_RADIUS;
+}
+
+void GeoReference::distances(const int32_t *lats, const int32_t *lons, float *out, unsigned int n) const {
+  // 32 bit lanes without branches or calls besides sqrt, so the loop vectorizes
+  // where the target has SIMD and sqrt need not set errno (-fno-math-errno)
+  const uint32_t _latitude = latitude, _longitude = longitude;
+  const float _north_scale = north_scale, _east_scale = east_scale;
+  for (unsigned int i = 0; i < n; i++) {
+    // offsets wrap like the 32 bit long of the targets
+    float east = int32_t(uint32_t(lons[i]) - _longitude) * _east_scale;
+    float north = int32_t(uint32_t(lats[i]) - _latitude) * _north_scale;
+    out[i] = sqrt(east * east + north * north);
+  }
+}
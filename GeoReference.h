@@ -0,0 +1,102 @@
+/*
+  GeoReference - a fixed reference point for fast distances and local coordinates.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+ 
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GeoReference_h
+#define GeoReference_h
+
+#include "FarmGPS.h"
+
+// earth radius in meters, same sphere as FarmGPS::distance_between()
+#define GPS_EARTH_RADIUS 6372795
+
+// meters per degree * 10^-7 along a meridian
+#define GPS_METERS_PER_E7 (GPS_EARTH_RADIUS * M_PI / 180.0 / 10000000.0)
+
+// Reference point, e.g. the origin of an A-B line, with its trig cached.
+// Local coordinates are east/north meters in the tangent plane of the
+// reference, accurate to centimeters within a few kilometers.
+// Positions are degrees * 10^7 as returned by FarmGPS::get_position_e7().
+class GeoReference {
+private:
+  //-------------
+  // data members
+  //-------------
+
+  long latitude;
+  long longitude;
+  float sin_latitude;
+  float cos_latitude;
+
+  // meters per degree * 10^-7 north and east
+  float north_scale;
+  float east_scale;
+
+public:
+  //---------------------------------------------------------
+  //public member functions implemented in GeoReference.cpp
+  //---------------------------------------------------------
+
+  //Constructors
+  GeoReference();
+  GeoReference(long latitude, long longitude);
+
+  // Moves the reference, computes the cached trig
+  void set(long latitude, long longitude);
+
+  // Great circle distance in meters to a position, using the cached trig
+  float distance_to(long latitude, long longitude) const;
+
+  // Local distances in meters from the reference for n positions in packed 32 bit arrays
+  void distances(const int32_t *latitudes, const int32_t *longitudes, float *out, unsigned int n) const;
+
+  //------------------------------
+  //public inline member functions
+  //------------------------------
+
+  // reference position in degrees * 10^7
+  inline long get_latitude() const {
+    return latitude;
+  }
+
+  inline long get_longitude() const {
+    return longitude;
+  }
+
+  // east and north meters of a position in the tangent plane of the reference
+  inline void to_local(long lat, long lon, float *east, float *north) const {
+    if (east) *east = (lon - longitude) * east_scale;
+    if (north) *north = (lat - latitude) * north_scale;
+  }
+
+  // position of east and north meters in the tangent plane of the reference
+  inline void from_local(float east, float north, long *lat, long *lon) const {
+    float _lat = north / north_scale, _lon = east / east_scale;
+    if (lat) *lat = latitude + long(_lat < 0 ? _lat - 0.5 : _lat + 0.5);
+    if (lon) *lon = longitude + long(_lon < 0 ? _lon - 0.5 : _lon + 0.5);
+  }
+
+  // equirectangular distance in meters, for sub-kilometer ranges
+  inline float local_distance(long lat, long lon) const {
+    float east = (lon - longitude) * east_scale;
+    float north = (lat - latitude) * north_scale;
+    return sqrt(east * east + north * north);
+  }
+};
+
+#endif
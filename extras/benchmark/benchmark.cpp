@@ -0,0 +1,519 @@
+/*
+  FarmGPS benchmark - replays recorded receiver logs through the decoder on a host.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Build from this directory:
+//   g++ -O2 -I../.. ../../FarmGPS.cpp ../../GeoReference.cpp benchmark.cpp -o benchmark
+// Usage:
+//   benchmark [-n repeats] [-t MB/s] [log ...]
+// Without logs a built-in corpus of NMEA and Trimble framed sentences is used,
+// clean and with line noise.
+// Before timing, each corpus is decoded byte at a time and in chunks of several
+// sizes, which must commit the same sentences with bit identical fields; the
+// clean corpus must decode to the values it was written with, without errors,
+// and fixes at the limits of the binary fix record must encode as expected.
+// Exits 1 when a check fails and 2 when a replay is slower than the threshold,
+// so a script can gate on both. The threshold is BENCHMARK_THRESHOLD MB/s by
+// default, -t sets another and -t 0 only checks.
+
+#include "FarmGPS.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// MB/s that a replay must reach, well below a current desktop with -O2 so the
+// gate only trips on regressions; raise it with -t on a known build machine.
+// A profiling build reads the clock per character and is not gated
+#ifndef BENCHMARK_THRESHOLD
+#ifndef GPS_PROFILE
+#define BENCHMARK_THRESHOLD 40
+#else
+#define BENCHMARK_THRESHOLD 0
+#endif
+#endif
+
+//-------------------------
+// clock for the host build
+//-------------------------
+
+static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+unsigned long millis() {
+  return micros() / 1000;
+}
+
+//----------------
+// built-in corpus
+//----------------
+
+// Appends $body*hh\r\n
+static void add_nmea(std::string &corpus, const char *body) {
+  byte parity = 0;
+  for (const char *c = body; *c; c++)
+    parity ^= *c;
+
+  char sentence[100];
+  snprintf(sentence, sizeof sentence, "$%s*%02X\r\n", body, parity);
+  corpus += sentence;
+}
+
+#ifndef GPS_NO_TRIMBLE
+
+// Appends a byte of a Trimble frame, DLE is sent twice
+static void add_stuffed(std::string &corpus, byte b) {
+  if (b == GPS_TRIMBLE_DLE)
+    corpus += char(b);
+  corpus += char(b);
+}
+
+// Appends a Trimble frame: start, payload, sum high, sum low, DLE, ETX
+static void add_trimble(std::string &corpus, const char *payload) {
+  unsigned int sum = 0;
+  corpus += char(GPS_TRIMBLE_START);
+  for (const char *c = payload; *c; c++) {
+    sum += byte(*c);
+    add_stuffed(corpus, *c);
+  }
+  add_stuffed(corpus, sum >> 8);
+  add_stuffed(corpus, sum & 0xFF);
+  corpus += char(GPS_TRIMBLE_DLE);
+  corpus += char(GPS_TRIMBLE_ETX);
+}
+
+#endif
+
+// values of a sentence in the built-in corpus, with the flag of its callback
+struct Expected {
+  unsigned int sentence;
+  unsigned long time;
+  long latitude;
+  long longitude;
+  float altitude;
+  int quality;
+  float speed;
+  float course;
+  float xte;
+};
+
+static inline void expect(std::vector<Expected> &values, unsigned int sentence) {
+  Expected _e;
+  memset(&_e, 0, sizeof _e);
+  _e.sentence = sentence;
+  values.push_back(_e);
+}
+
+#ifdef GPGGA_TERM
+// ddmm.mmmmmmm with minutes * 10^7 to degrees * 10^7, rounded
+static long to_degrees(long whole, long minutes) {
+  return whole * 10000000L + (minutes + 30) / 60;
+}
+#endif
+
+// One second of 10 Hz output: GGA, VTG, XTE per fix, GSV/GSA once, and the
+// values of the sentences that are compiled in
+static std::string builtin_corpus(std::vector<Expected> &values) {
+  std::string corpus;
+  char body[100];
+
+  for (int second = 0; second < 60; second++) {
+    add_nmea(corpus, "GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+    add_nmea(corpus, "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00");
+    for (int tenth = 0; tenth < 10; tenth++) {
+      long _latitude = 1234567 + second * 97 + tenth, _longitude = 7654321 + second * 13;
+      snprintf(body, sizeof body,
+        "GNGGA,1235%02d.%d0,5212.%07ld,N,00535.%07ld,E,4,12,0.7,%d.%03d,M,46.9,M,1.0,0000",
+        second, tenth, _latitude, _longitude, 4, second * 7);
+      add_nmea(corpus, body);
+#ifdef GPGGA_TERM
+      expect(values, GPS_SENTENCE_GGA);
+      values.back().time = ((12 * 60 + 35) * 60 + second) * 100UL + tenth * 10;
+      values.back().latitude = to_degrees(52, 120000000L + _latitude);
+      values.back().longitude = to_degrees(5, 350000000L + _longitude);
+      values.back().altitude = 4 + second * 7 / 1000.0;
+      values.back().quality = 4;
+#endif
+      snprintf(body, sizeof body, "GPVTG,%03d.%d,T,034.4,M,005.5,N,010.2,K,D", 54 + second, tenth);
+      add_nmea(corpus, body);
+#ifdef GPVTG_TERM
+      expect(values, GPS_SENTENCE_VTG);
+      values.back().speed = 5.5;
+      values.back().course = 54 + second + tenth / 10.0;
+#endif
+      snprintf(body, sizeof body, "GPXTE,A,A,0.%02d,L,N,D", second + tenth);
+      add_nmea(corpus, body);
+#ifdef GPXTE_TERM
+      expect(values, GPS_SENTENCE_XTE);
+      values.back().xte = (second + tenth) / 100.0;
+#endif
+    }
+#ifndef GPS_NO_TRIMBLE
+    // Trimble framed ROXTE
+    snprintf(body, sizeof body, "@ROXTE,0.%02d", second);
+    add_trimble(corpus, body);
+#ifdef ROXTE_TERM
+    expect(values, GPS_SENTENCE_XTE);
+    values.back().xte = second / 100.0;
+#endif
+#endif
+  }
+  return corpus;
+}
+
+// The corpus after a noisy radio link, one corrupted byte in about 400
+static std::string noisy_corpus(const std::string &clean) {
+  std::string corpus = clean;
+  unsigned long seed = 12345;
+  for (size_t i = 0; i < corpus.size(); i++) {
+    seed = seed * 1103515245UL + 12345;
+    if ((seed >> 16) % 400 == 0)
+      corpus[i] ^= 1 << (seed >> 8) % 8;
+  }
+  return corpus;
+}
+
+//------
+// check
+//------
+
+struct Committed {
+  unsigned int sentence;
+  GpsFix fix;
+};
+
+static std::vector<Committed> *recording;
+
+static void record_sentence(FarmGPS &, unsigned int sentence, const GpsFix &fix) {
+  Committed _c = { sentence, fix };
+  recording->push_back(_c);
+}
+
+// Decoded fields compare as stored, the stamps follow the host clock
+#define SAME(field) (!memcmp(&a.field, &b.field, sizeof a.field))
+
+static bool same_fix(const GpsFix &a, const GpsFix &b) {
+  return SAME(time) && SAME(date.day) && SAME(date.month) && SAME(date.year) &&
+    SAME(latitude) && SAME(longitude) && SAME(altitude) && SAME(speed) &&
+    SAME(course) && SAME(xte) && SAME(quality);
+}
+
+// Floats of decimal terms match to their last bits
+static bool near(float a, float b) {
+  return fabs(a - b) <= 1e-5 * (1 + fabs(b));
+}
+
+// Checks the fields of each committed sentence against the corpus, returns
+// false at the first that differs
+static bool check_values(const char *name, const std::vector<Committed> &committed,
+  const std::vector<Expected> &values) {
+  size_t n = 0;
+  for (size_t i = 0; i < committed.size(); i++) {
+    if (committed[i].sentence == GPS_SENTENCE_EPOCH)
+      continue;
+    const GpsFix &f = committed[i].fix;
+    const Expected *e = n < values.size() ? &values[n] : 0;
+    bool _same = e && e->sentence == committed[i].sentence;
+    if (_same && e->sentence == GPS_SENTENCE_GGA)
+      _same = f.time == e->time && f.latitude == e->latitude && f.longitude == e->longitude &&
+        near(f.altitude, e->altitude) && f.quality == e->quality;
+    else if (_same && e->sentence == GPS_SENTENCE_VTG)
+      _same = near(f.speed, e->speed) && near(f.course, e->course);
+    else if (_same && e->sentence == GPS_SENTENCE_XTE)
+      _same = near(f.xte, e->xte);
+    if (!_same) {
+      printf("%-24s sentence %lu decodes as %x time %lu %ld %ld altitude %g quality %d"
+        " speed %g course %g xte %g\n", name, (unsigned long)n, committed[i].sentence, f.time,
+        f.latitude, f.longitude, f.altitude, f.quality, f.speed, f.course, f.xte);
+      return false;
+    }
+    n++;
+  }
+  if (n != values.size()) {
+    printf("%-24s %lu of %lu sentences decoded\n", name, (unsigned long)n, (unsigned long)values.size());
+    return false;
+  }
+  return true;
+}
+
+// Decodes the corpus once byte at a time, or in chunks when chunk > 0
+static void record_pass(const std::string &corpus, size_t chunk, std::vector<Committed> &out, FarmGPS &gps) {
+  gps.set_callback(record_sentence);
+  recording = &out;
+  const char *data = corpus.data();
+  size_t length = corpus.size();
+  if (chunk) {
+    for (size_t offset = 0; offset < length; offset += chunk)
+      gps.decode_buffer(data + offset, length - offset < chunk ? length - offset : chunk);
+  }
+  else {
+    for (size_t offset = 0; offset < length; offset++)
+      gps.decode(data[offset]);
+  }
+}
+
+// Returns false when a chunked decode differs from the byte at a time decode,
+// or for a corpus with known values when a value differs or there are errors
+static bool check(const char *name, const std::string &corpus, const std::vector<Expected> *values) {
+  static const size_t chunks[] = { 1, 7, 64, 256, 0 };
+  std::vector<Committed> expected;
+  FarmGPS bytewise;
+  record_pass(corpus, 0, expected, bytewise);
+#ifndef GPS_NO_STATS
+  GpsStats expected_stats;
+  bytewise.stats(expected_stats);
+#endif
+  if (values && !check_values(name, expected, *values))
+    return false;
+
+  for (size_t i = 0; i < sizeof chunks / sizeof chunks[0]; i++) {
+    size_t _chunk = chunks[i] ? chunks[i] : corpus.size() + 1;
+    std::vector<Committed> actual;
+    FarmGPS chunked;
+    record_pass(corpus, _chunk, actual, chunked);
+
+    size_t n = 0;
+    while (n < expected.size() && n < actual.size() && expected[n].sentence == actual[n].sentence &&
+           same_fix(expected[n].fix, actual[n].fix))
+      n++;
+    bool _same = n == expected.size() && n == actual.size();
+#ifndef GPS_NO_STATS
+    GpsStats actual_stats;
+    chunked.stats(actual_stats);
+    _same = _same && !memcmp(&expected_stats, &actual_stats, sizeof expected_stats);
+#endif
+    if (!_same) {
+      if (n == expected.size() && n == actual.size())
+        printf("%-24s decode_buffer() in chunks of %lu differs from decode() in the statistics\n",
+          name, (unsigned long)_chunk);
+      else
+        printf("%-24s decode_buffer() in chunks of %lu differs from decode() at sentence %lu of %lu\n",
+          name, (unsigned long)_chunk, (unsigned long)n, (unsigned long)expected.size());
+      return false;
+    }
+  }
+
+#ifndef GPS_NO_STATS
+  if (values && (expected_stats.failed_checksum || expected_stats.failed_trimble ||
+                 expected_stats.aborted_sentences || expected_stats.term_overflows)) {
+    printf("%-24s decode errors in a clean corpus\n", name);
+    return false;
+  }
+#endif
+  return true;
+}
+
+// little endian field of a binary fix record
+static unsigned long record_field(const byte *record, size_t offset, size_t size) {
+  unsigned long value = 0;
+  for (size_t i = size; i > 0; i--)
+    value = value << 8 | record[offset + i - 1];
+  return value;
+}
+
+// Encodes fixes at and beyond the limits of the binary fix record, returns
+// false when a field does not read back as expected
+static bool check_record() {
+  // invalid markers of a decoder without a fix
+  FarmGPS empty;
+  byte invalid[GPS_FIX_RECORD_SIZE];
+  empty.encode_fix(invalid);
+  if (record_field(invalid, 2, 4) != GPS_INVALID_LONG ||
+      record_field(invalid, 6, 4) != GPS_INVALID_ANGLE || record_field(invalid, 10, 4) != GPS_INVALID_ANGLE ||
+      record_field(invalid, 14, 4) != GPS_INVALID_LONG || record_field(invalid, 18, 2) != 0xFFFF ||
+      record_field(invalid, 20, 2) != 0xFFFF || record_field(invalid, 22, 2) != 0x7FFF) {
+    printf("encode_fix() without a fix gives other invalid markers than FarmGPS.h\n");
+    return false;
+  }
+
+#if defined(GPVTG_TERM) && defined(GPXTE_TERM)
+  struct Limit {
+    const char *vtg;
+    const char *xte;
+    unsigned int speed, course, xte_cm;
+  };
+  static const Limit limits[] = {
+    { "GPVTG,000.0,T,,M,000.0,N,,K,D", "GPXTE,A,A,0.00,L,N,D", 0, 0, 0 },
+    { "GPVTG,359.5,T,,M,010.0,N,,K,D", "GPXTE,A,A,12.5,L,N,D", 514, 35950, 1250 },
+    { "GPVTG,655.3,T,,M,1273.8,N,,K,D", "GPXTE,A,A,327.66,L,N,D", 65529, 65530, 32766 },
+    { "GPVTG,700.0,T,,M,2000.0,N,,K,D", "GPXTE,A,A,400.00,L,N,D", 0xFFFE, 0xFFFE, 0x7FFE },
+    { "GPVTG,-1.0,T,,M,-1.0,N,,K,D", "GPXTE,A,A,-400.00,L,N,D", 0, 0, 0x8001 }
+  };
+
+  for (size_t i = 0; i < sizeof limits / sizeof limits[0]; i++) {
+    std::string sentences;
+    add_nmea(sentences, limits[i].vtg);
+    add_nmea(sentences, limits[i].xte);
+    FarmGPS gps;
+    gps.decode_buffer(sentences.data(), sentences.size());
+
+    byte record[GPS_FIX_RECORD_SIZE];
+    gps.encode_fix(record);
+    unsigned int speed = record_field(record, 18, 2);
+    unsigned int course = record_field(record, 20, 2);
+    unsigned int xte = record_field(record, 22, 2);
+    if (speed != limits[i].speed || course != limits[i].course || xte != limits[i].xte_cm) {
+      printf("encode_fix() of %s %s gives speed %u course %u xte %u\n",
+        limits[i].vtg, limits[i].xte, speed, course, xte);
+      return false;
+    }
+  }
+#endif
+  return true;
+}
+
+//-------
+// replay
+//-------
+
+struct Result {
+  double seconds;
+  unsigned long sentences;
+};
+
+static unsigned long committed;
+
+static void count_sentence(FarmGPS &, unsigned int sentence, const GpsFix &) {
+  if (sentence != GPS_SENTENCE_EPOCH)
+    committed++;
+}
+
+// Feeds the corpus repeats times byte at a time, or in chunks when chunk > 0
+static Result replay(const std::string &corpus, int repeats, size_t chunk, FarmGPS &gps) {
+  Result result = { 0, 0 };
+  committed = 0;
+  gps.set_callback(count_sentence);
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < repeats; i++) {
+    const char *data = corpus.data();
+    size_t length = corpus.size();
+    if (chunk) {
+      for (size_t offset = 0; offset < length; offset += chunk)
+        gps.decode_buffer(data + offset, length - offset < chunk ? length - offset : chunk);
+    }
+    else {
+      for (size_t offset = 0; offset < length; offset++)
+        gps.decode(data[offset]);
+    }
+  }
+
+  result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  result.sentences = committed;
+  return result;
+}
+
+// Prints a result, returns its MB/s
+static double report(const char *name, const char *mode, const std::string &corpus, int repeats,
+  const Result &result, FarmGPS &gps) {
+  double bytes = double(corpus.size()) * repeats;
+  double rate = bytes / result.seconds / 1e6;
+  printf("%-24s %-8s %10.2f MB/s %10.1f ns/sentence %10lu sentences",
+    name, mode, rate,
+    result.sentences ? result.seconds * 1e9 / result.sentences : 0.0, result.sentences);
+#ifndef GPS_NO_STATS
+  GpsStats stats;
+  gps.stats(stats);
+  printf(" %8lu failed checksum %8lu failed Trimble %8lu unknown %8lu aborted",
+    stats.failed_checksum, stats.failed_trimble, stats.unknown_sentences, stats.aborted_sentences);
+#else
+  (void)gps;
+#endif
+  printf("\n");
+  return rate;
+}
+
+// Checks and times a corpus, returns the exit status
+static int run(const char *name, const std::string &corpus, int repeats,
+  const std::vector<Expected> *values, double threshold) {
+  if (!check(name, corpus, values))
+    return 1;
+
+  FarmGPS bytewise, chunked;
+  double rate = report(name, "decode", corpus, repeats, replay(corpus, repeats, 0, bytewise), bytewise);
+  double buffer_rate = report(name, "buffer", corpus, repeats, replay(corpus, repeats, 256, chunked), chunked);
+  if (buffer_rate < rate)
+    rate = buffer_rate;
+  if (rate < threshold) {
+    printf("%-24s below the threshold of %.2f MB/s\n", name, threshold);
+    return 2;
+  }
+  return 0;
+}
+
+static bool read_log(const char *path, std::string &corpus) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return false;
+
+  char buffer[4096];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof buffer, file)) > 0)
+    corpus.append(buffer, n);
+  fclose(file);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int repeats = 100;
+  double threshold = BENCHMARK_THRESHOLD;
+  std::vector<const char *> logs;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-n") && i + 1 < argc)
+      repeats = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc)
+      threshold = atof(argv[++i]);
+    else
+      logs.push_back(argv[i]);
+  }
+
+  // the worst status of all corpora, a failed check over a slow one
+  int status = check_record() ? 0 : 1;
+  if (logs.empty()) {
+    std::vector<Expected> values;
+    std::string corpus = builtin_corpus(values);
+    int _status = run("built-in", corpus, repeats, &values, threshold);
+    if (_status == 1 || !status)
+      status = _status;
+    _status = run("built-in noisy", noisy_corpus(corpus), repeats, 0, threshold);
+    if (_status == 1 || !status)
+      status = _status;
+    return status;
+  }
+
+  for (size_t i = 0; i < logs.size(); i++) {
+    std::string corpus;
+    if (!read_log(logs[i], corpus)) {
+      fprintf(stderr, "cannot read %s\n", logs[i]);
+      return 1;
+    }
+    int _status = run(logs[i], corpus, repeats, 0, threshold);
+    if (_status == 1 || !status)
+      status = _status;
+  }
+  return status;
+}
@@ -0,0 +1,212 @@
+/*
+  FieldBoundary check - compares the strip index with a test of every edge.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Build from this directory:
+//   g++ -O2 -I../.. ../../GeoReference.cpp ../../FieldBoundary.cpp check_boundary.cpp -o check_boundary
+// Usage:
+//   check_boundary [seed]
+// Builds random fields of one ring and with obstacles, with indexes from a
+// single strip to the full size, and tests random positions in and around
+// them. contains() must agree with a ray cast over all edges and
+// distance_to_edge() with the nearest of all edges, within and beyond a
+// range. Positions within a centimeter of an edge are left out, rounding
+// decides their side. Exits 1 when a check fails.
+
+#include "FieldBoundary.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//-------------------------
+// clock for the host build
+//-------------------------
+
+unsigned long micros() {
+  return 0;
+}
+
+unsigned long millis() {
+  return 0;
+}
+
+//------
+// field
+//------
+
+struct Field {
+  std::vector<long> latitudes;
+  std::vector<long> longitudes;
+  std::vector<unsigned int> ring_ends;
+};
+
+static double random_unit() {
+  return rand() / (RAND_MAX + 1.0);
+}
+
+// Ring around a center with random radii, a star shape with concave corners
+static void add_ring(Field &field, long latitude, long longitude, double radius, unsigned int vertices) {
+  for (unsigned int i = 0; i < vertices; i++) {
+    double angle = 2 * M_PI * (i + 0.8 * random_unit()) / vertices;
+    double r = radius * (0.3 + 0.7 * random_unit());
+    field.latitudes.push_back(latitude + long(r * cos(angle)));
+    field.longitudes.push_back(longitude + long(r * sin(angle) * 1.6));
+  }
+  field.ring_ends.push_back(field.latitudes.size());
+}
+
+//------------
+// brute force
+//------------
+
+struct Edges {
+  std::vector<float> east1, north1, east2, north2;
+};
+
+// All edges in the local coordinates of the boundary
+static void local_edges(const Field &field, const GeoReference &reference, Edges &edges) {
+  unsigned int _start = 0;
+  for (size_t r = 0; r < field.ring_ends.size(); r++) {
+    unsigned int _end = field.ring_ends[r];
+    for (unsigned int i = _start; i < _end; i++) {
+      unsigned int _next = i + 1 == _end ? _start : i + 1;
+      float e1, n1, e2, n2;
+      reference.to_local(field.latitudes[i], field.longitudes[i], &e1, &n1);
+      reference.to_local(field.latitudes[_next], field.longitudes[_next], &e2, &n2);
+      edges.east1.push_back(e1);
+      edges.north1.push_back(n1);
+      edges.east2.push_back(e2);
+      edges.north2.push_back(n2);
+    }
+    _start = _end;
+  }
+}
+
+static float nearest_edge(const Edges &edges, float east, float north) {
+  float _nearest = GPS_INVALID_FLOAT;
+  for (size_t i = 0; i < edges.east1.size(); i++) {
+    float e1 = edges.east1[i], n1 = edges.north1[i];
+    float de = edges.east2[i] - e1, dn = edges.north2[i] - n1;
+    float _length = de * de + dn * dn;
+    float t = _length > 0 ? ((east - e1) * de + (north - n1) * dn) / _length : 0;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+    float ee = e1 + t * de - east, en = n1 + t * dn - north;
+    float _distance = sqrt(ee * ee + en * en);
+    if (_distance < _nearest)
+      _nearest = _distance;
+  }
+  return _nearest;
+}
+
+static bool inside_edges(const Edges &edges, float east, float north) {
+  bool _inside = false;
+  for (size_t i = 0; i < edges.east1.size(); i++) {
+    float e1 = edges.east1[i], n1 = edges.north1[i], e2 = edges.east2[i], n2 = edges.north2[i];
+    if ((n1 > north) != (n2 > north) && east < e1 + (north - n1) * (e2 - e1) / (n2 - n1))
+      _inside = !_inside;
+  }
+  return _inside;
+}
+
+//-------
+// checks
+//-------
+
+static bool check_field(const char *name, const Field &field, unsigned int index_size) {
+  std::vector<uint16_t> index(index_size);
+  FieldBoundary boundary(&field.latitudes[0], &field.longitudes[0], field.latitudes.size(),
+    &index[0], index_size, &field.ring_ends[0], field.ring_ends.size());
+  if (!boundary.get_strips()) {
+    printf("%-12s does not fit %u words of index\n", name, index_size);
+    return false;
+  }
+
+  GeoReference reference(field.latitudes[0], field.longitudes[0]);
+  Edges edges;
+  local_edges(field, reference, edges);
+
+  long lat_min = field.latitudes[0], lat_max = lat_min, lon_min = field.longitudes[0], lon_max = lon_min;
+  for (size_t i = 0; i < field.latitudes.size(); i++) {
+    if (field.latitudes[i] < lat_min) lat_min = field.latitudes[i];
+    if (field.latitudes[i] > lat_max) lat_max = field.latitudes[i];
+    if (field.longitudes[i] < lon_min) lon_min = field.longitudes[i];
+    if (field.longitudes[i] > lon_max) lon_max = field.longitudes[i];
+  }
+  long lat_margin = (lat_max - lat_min) / 10, lon_margin = (lon_max - lon_min) / 10;
+
+  unsigned long errors = 0, queries = 0, inside = 0;
+  for (int q = 0; q < 20000; q++) {
+    long latitude = lat_min - lat_margin + long(random_unit() * (lat_max - lat_min + 2 * lat_margin));
+    long longitude = lon_min - lon_margin + long(random_unit() * (lon_max - lon_min + 2 * lon_margin));
+    float east, north;
+    reference.to_local(latitude, longitude, &east, &north);
+    float _nearest = nearest_edge(edges, east, north);
+    if (_nearest < 0.01)
+      continue;
+    queries++;
+
+    bool _inside = inside_edges(edges, east, north);
+    inside += _inside;
+    if (boundary.contains(latitude, longitude) != _inside && errors++ < 5)
+      printf("%-12s contains(%ld, %ld) is %d, all edges give %d\n", name, latitude, longitude, !_inside, _inside);
+
+    float _distance = boundary.distance_to_edge(latitude, longitude);
+    if (fabs(_distance - _nearest) > 0.001 && errors++ < 5)
+      printf("%-12s distance_to_edge(%ld, %ld) is %.3f, all edges give %.3f\n", name, latitude, longitude, _distance, _nearest);
+
+    // a range of a boom width, invalid beyond it
+    float _range = 12;
+    float _ranged = boundary.distance_to_edge(latitude, longitude, _range);
+    float _expected = _nearest < _range ? _nearest : GPS_INVALID_FLOAT;
+    if (fabs(_ranged - _expected) > 0.001 && errors++ < 5)
+      printf("%-12s distance_to_edge(%ld, %ld, %.0f) is %.3f, all edges give %.3f\n", name, latitude, longitude, _range, _ranged, _expected);
+  }
+  printf("%-12s %u strips, %lu of %lu positions inside, %lu differ\n", name, boundary.get_strips(), inside, queries, errors);
+  return errors == 0;
+}
+
+int main(int argc, char **argv) {
+  srand(argc > 1 ? atoi(argv[1]) : 1);
+  bool ok = true;
+
+  // about 500 m across
+  Field field;
+  add_ring(field, 521234567, 55654321, 25000, 200);
+  unsigned int vertices = field.latitudes.size();
+  ok = check_field("one ring", field, FIELD_BOUNDARY_INDEX_PER_VERTEX * vertices) && ok;
+  ok = check_field("many strips", field, 40 * vertices) && ok;
+  ok = check_field("few strips", field, vertices + 40) && ok;
+  ok = check_field("one strip", field, vertices + 2) && ok;
+
+  // obstacles within the field
+  add_ring(field, 521234567 + 8000, 55654321, 3000, 12);
+  add_ring(field, 521234567 - 6000, 55654321 + 9000, 2000, 8);
+  add_ring(field, 521234567, 55654321 - 12000, 1500, 5);
+  vertices = field.latitudes.size();
+  ok = check_field("obstacles", field, FIELD_BOUNDARY_INDEX_PER_VERTEX * vertices) && ok;
+
+  // a long field with many vertices, many strips
+  Field strip;
+  add_ring(strip, 521234567, 55654321, 90000, 3000);
+  ok = check_field("long field", strip, FIELD_BOUNDARY_INDEX_PER_VERTEX * 3000) && ok;
+  ok = check_field("long, many", strip, 40 * 3000) && ok;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+/*
+  FixLog check - reads truncated and corrupted fix files under AddressSanitizer.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Build from this directory:
+//   g++ -g -O1 -fsanitize=address,undefined -I../.. ../../GeoReference.cpp ../../FixLog.cpp check_fixlog.cpp -o check_fixlog
+// Usage:
+//   check_fixlog [iterations]
+// Writes a file of fixes, which must read back unchanged and seek to the
+// first fix at a time. Every prefix of the file and files with flipped,
+// replaced and cut bytes are then read from heap blocks of exactly their
+// length, so the sanitizer reports any read beyond the data, and readers
+// must reach the end of each. Exits 1 when a check fails.
+
+#include "FixLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//-------------------------
+// clock for the host build
+//-------------------------
+
+unsigned long micros() {
+  return 0;
+}
+
+unsigned long millis() {
+  return 0;
+}
+
+//-----
+// file
+//-----
+
+#define CHECK_FIXES 1000
+
+// more records than a file of this size can hold, a reader past it loops
+#define CHECK_MAX_RECORDS 200000
+
+static std::vector<byte> file;
+
+static void write_file(const byte *data, unsigned int length, void *) {
+  file.insert(file.end(), data, data + length);
+}
+
+static bool same(const FixLogRecord &a, const FixLogRecord &b) {
+  return a.time == b.time && a.latitude == b.latitude && a.longitude == b.longitude &&
+    a.speed == b.speed && a.course == b.course && a.xte == b.xte && a.quality == b.quality;
+}
+
+static unsigned long seed = 1;
+
+static unsigned int random_number() {
+  seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return seed >> 33;
+}
+
+// Reads all fixes and then from a time on, false when a reader does not end
+static bool read_all(const std::vector<byte> &data, unsigned long time) {
+  byte *_heap = (byte *)malloc(data.size() ? data.size() : 1);
+  if (!data.empty())
+    memcpy(_heap, &data[0], data.size());
+
+  FixLogReader reader(_heap, data.size());
+  FixLogRecord record;
+  unsigned long n = 0;
+  reader.valid();
+  while (n < CHECK_MAX_RECORDS && reader.next(record))
+    n++;
+  if (n < CHECK_MAX_RECORDS) {
+    reader.seek(time);
+    for (n = 0; n < CHECK_MAX_RECORDS && reader.next(record); )
+      n++;
+  }
+  free(_heap);
+  return n < CHECK_MAX_RECORDS;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 20000;
+
+  byte buffer[100];
+  FixLogWriter writer(buffer, sizeof buffer, write_file);
+  std::vector<FixLogRecord> fixes;
+  for (int i = 0; i < CHECK_FIXES; i++) {
+    FixLogRecord record = { (unsigned long)i * 10, 521234567L + i * 3, 55012345L - i,
+      i % 500, i * 37 % 36000, i % 200 - 100, byte(i % 5) };
+    if (i % 97 == 0)
+      record.time = GPS_INVALID_LONG;
+    fixes.push_back(record);
+    writer.add(record);
+  }
+  writer.close();
+
+  // round trip
+  FixLogReader reader(&file[0], file.size());
+  FixLogRecord record;
+  size_t n = 0;
+  bool ok = reader.valid();
+  while (reader.next(record)) {
+    if (n >= fixes.size() || !same(record, fixes[n]))
+      ok = false;
+    n++;
+  }
+  if (!ok || n != fixes.size()) {
+    printf("round trip gives %u of %u fixes%s\n", (unsigned int)n, CHECK_FIXES, ok ? "" : ", changed");
+    return 1;
+  }
+  if (!reader.seek(5001) || !reader.next(record) || record.time != 5010) {
+    printf("seek(5001) does not give the fix at 5010\n");
+    return 1;
+  }
+
+  // truncated files
+  std::vector<byte> _data;
+  unsigned long failed = 0;
+  for (size_t length = 0; length <= file.size(); length++) {
+    _data.assign(file.begin(), file.begin() + length);
+    if (!read_all(_data, random_number() % 12000) && failed++ < 5)
+      printf("file cut at %u bytes does not end\n", (unsigned int)length);
+  }
+
+  // corrupted files
+  for (long i = 0; i < iterations; i++) {
+    _data = file;
+    for (int changes = random_number() % 6 + 1; changes > 0; changes--) {
+      size_t offset = random_number() % _data.size();
+      switch (random_number() % 4) {
+      case 0:
+        _data[offset] ^= 1 << random_number() % 8;
+        break;
+      case 1:
+        _data[offset] = random_number();
+        break;
+      case 2:
+        _data.resize(offset + 1);
+        break;
+      default:
+        _data[offset] = 0xFF;
+        break;
+      }
+    }
+    if (!read_all(_data, random_number() % 12000) && failed++ < 5)
+      printf("corrupted file %ld does not end\n", i);
+  }
+
+  printf("%u byte file, %lu cut and corrupted files do not end\n", (unsigned int)file.size(), failed);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,133 @@
+/*
+  FixHistory check - compares nearest() with a linear scan of the history.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Build from this directory:
+//   g++ -O2 -I../.. ../../GeoReference.cpp ../../FixHistory.cpp check_history.cpp -o check_history
+// Usage:
+//   check_history [seed]
+// Fills histories at several fix rates, with jitter, repeated times, a
+// millis() wrap and gaps beyond the 16 bit age range, then looks up random
+// times. nearest() must return the entry a linear scan of get() finds, the
+// newer of two as near, and get() the add() times to 10 ms.
+// Exits 1 when a check fails.
+
+#include "FixHistory.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+//-------------------------
+// clock for the host build
+//-------------------------
+
+unsigned long micros() {
+  return 0;
+}
+
+unsigned long millis() {
+  return 0;
+}
+
+//-------
+// checks
+//-------
+
+struct Rate {
+  const char *name;
+  unsigned long interval;   // milliseconds between fixes
+  unsigned long jitter;     // up to this many milliseconds later
+  unsigned int capacity;
+};
+
+static const Rate rates[] = {
+  { "10 Hz", 100, 30, 300 },
+  { "20 Hz", 50, 9, 300 },
+  { "1 Hz", 1000, 200, 1000 },    // spans more than the 16 bit age range
+  { "5 s", 5000, 0, 100 },
+  { "repeated", 10, 25, 50 }      // several fixes in one 10 ms step
+};
+
+// Index of the entry with the time nearest to time, the lowest of equals
+static int scan(const FixHistory &history, unsigned long time) {
+  int best = -1;
+  long distance = 0;
+  for (unsigned int i = 0; i < history.size(); i++) {
+    FixHistoryPoint point;
+    history.get(i, point);
+    long _distance = labs(long(point.time - time));
+    if (best < 0 || _distance < distance) {
+      best = i;
+      distance = _distance;
+    }
+  }
+  return best;
+}
+
+static bool check_rate(const Rate &rate) {
+  std::vector<FixHistoryEntry> entries(rate.capacity);
+  FixHistory history(&entries[0], rate.capacity);
+  std::vector<unsigned long> added;
+
+  // starts before the millis() wrap
+  unsigned long time = 0xFFFFFFFFUL - 30000 - rand() % 1000;
+  unsigned long errors = 0, queries = 0;
+  for (int n = 0; n < 3000; n++) {
+    time += rate.interval + (rate.jitter ? rand() % (rate.jitter + 1) : 0);
+    // a lost link now and then
+    if (rand() % 500 == 0)
+      time += 60000 + rand() % 900000;
+    history.add(521234567 + rand() % 1000, 55654321 + rand() % 1000, time, 4, 5.0);
+    added.push_back(time);
+
+    FixHistoryPoint newest;
+    history.get(0, newest);
+    if (newest.time != time / 10 * 10) {
+      printf("%-10s get() of the newest fix at %lu gives %lu\n", rate.name, time, newest.time);
+      return false;
+    }
+    FixHistoryPoint oldest;
+    history.get(history.size() - 1, oldest);
+    if (newest.time - oldest.time > 655350) {
+      printf("%-10s keeps an entry %lu ms old\n", rate.name, newest.time - oldest.time);
+      return false;
+    }
+
+    for (int q = 0; q < 5; q++) {
+      unsigned long span = time - oldest.time + 2000;
+      unsigned long at = oldest.time - 1000 + (unsigned long)(rand() % (span + 1));
+      int expected = scan(history, at), actual = history.nearest(at);
+      queries++;
+      if (expected != actual) {
+        if (errors++ < 5)
+          printf("%-10s nearest(%lu) gives entry %d, a scan %d\n", rate.name, at, actual, expected);
+      }
+    }
+  }
+  printf("%-10s %lu of %lu lookups differ from a scan\n", rate.name, errors, queries);
+  return errors == 0;
+}
+
+int main(int argc, char **argv) {
+  srand(argc > 1 ? atoi(argv[1]) : 1);
+  bool ok = true;
+  for (size_t i = 0; i < sizeof rates / sizeof rates[0]; i++)
+    ok = check_rate(rates[i]) && ok;
+  return ok ? 0 : 1;
+}
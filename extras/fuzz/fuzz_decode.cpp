@@ -0,0 +1,142 @@
+/*
+  FarmGPS fuzz target - checks decode() against decode_buffer() on any input.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Build from this directory with libFuzzer:
+//   clang++ -g -O1 -fsanitize=fuzzer,address,undefined -I../.. ../../FarmGPS.cpp ../../GeoReference.cpp fuzz_decode.cpp -o fuzz_decode
+//   ./fuzz_decode -dict=nmea.dict corpus/
+// or without libFuzzer, replaying inputs such as crashes found elsewhere:
+//   g++ -g -fsanitize=address,undefined -DFUZZ_REPLAY -I../.. ../../FarmGPS.cpp ../../GeoReference.cpp fuzz_decode.cpp -o fuzz_decode
+//   ./fuzz_decode input ...
+// The first input byte sets the decode_buffer() chunk size, the rest is fed
+// to one decoder byte at a time and to another in chunks. Both must commit
+// the same sentences with bit identical fields and count the same statistics.
+
+#include "FarmGPS.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+//-------------------------
+// clock for the host build
+//-------------------------
+
+// a fixed clock keeps the fix stamps of both decoders equal
+unsigned long micros() {
+  return 0;
+}
+
+unsigned long millis() {
+  return 0;
+}
+
+//-------------------
+// committed sentences
+//-------------------
+
+struct Committed {
+  unsigned int sentence;
+  GpsFix fix;
+};
+
+static std::vector<Committed> *recording;
+
+static void record(FarmGPS &, unsigned int sentence, const GpsFix &fix) {
+  Committed _c = { sentence, fix };
+  recording->push_back(_c);
+}
+
+// Fields compare as stored, so a float that decodes differently fails too
+#define SAME(field) (!memcmp(&a.field, &b.field, sizeof a.field))
+
+static bool same_fix(const GpsFix &a, const GpsFix &b) {
+  return SAME(time) && SAME(date.day) && SAME(date.month) && SAME(date.year) &&
+    SAME(latitude) && SAME(longitude) && SAME(altitude) && SAME(speed) &&
+    SAME(course) && SAME(xte) && SAME(quality) &&
+    SAME(last_GGA_fix) && SAME(last_VTG_fix) && SAME(last_XTE_fix) &&
+    SAME(last_epoch) && SAME(epoch_time) && SAME(last_start);
+}
+
+static void fail(const char *what, size_t at) {
+  fprintf(stderr, "decode() and decode_buffer() differ in %s at %lu\n", what, (unsigned long)at);
+  abort();
+}
+
+//------------
+// fuzz target
+//------------
+
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+  if (!size)
+    return 0;
+  size_t chunk = data[0] + 1;
+  const char *input = (const char *)data + 1;
+  size_t length = size - 1;
+
+  GpsConfig config = GPS_DEFAULT_CONFIG;
+  config.callback = record;
+  FarmGPS bytewise(config), chunked(config);
+
+  std::vector<Committed> expected, actual;
+  recording = &expected;
+  for (size_t i = 0; i < length; i++)
+    bytewise.decode(input[i]);
+  recording = &actual;
+  for (size_t offset = 0; offset < length; offset += chunk)
+    chunked.decode_buffer(input + offset, length - offset < chunk ? length - offset : chunk);
+
+  if (expected.size() != actual.size())
+    fail("the number of sentences", expected.size() < actual.size() ? expected.size() : actual.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (expected[i].sentence != actual[i].sentence || !same_fix(expected[i].fix, actual[i].fix))
+      fail("sentence", i);
+  }
+
+#ifndef GPS_NO_STATS
+  GpsStats a, b;
+  bytewise.stats(a);
+  chunked.stats(b);
+  if (memcmp(&a, &b, sizeof a))
+    fail("the statistics", 0);
+#endif
+  return 0;
+}
+
+#ifdef FUZZ_REPLAY
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    FILE *file = fopen(argv[i], "rb");
+    if (!file) {
+      fprintf(stderr, "cannot read %s\n", argv[i]);
+      return 1;
+    }
+    std::vector<unsigned char> input;
+    unsigned char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof buffer, file)) > 0)
+      input.insert(input.end(), buffer, buffer + n);
+    fclose(file);
+    LLVMFuzzerTestOneInput(input.empty() ? 0 : &input[0], input.size());
+  }
+  return 0;
+}
+
+#endif
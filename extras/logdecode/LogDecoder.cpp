@@ -0,0 +1,249 @@
+/*
+  LogDecoder - parallel decoding of recorded receiver logs with FarmGPS on a host.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LogDecoder.h"
+
+#include <thread>
+
+//-------
+// chunks
+//-------
+
+// First sentence start after a line end at or after offset, length if none
+static size_t next_boundary(const char *data, size_t length, size_t offset) {
+  if (offset == 0)
+    return 0;
+  for (size_t i = offset; i < length; i++) {
+    char c = data[i];
+    if ((c == '$' || c == '@' || byte(c) == GPS_TRIMBLE_START) && data[i - 1] == '\n')
+      return i;
+  }
+  return length;
+}
+
+//--------
+// workers
+//--------
+
+struct Chunk {
+  size_t warmup;    // offset decoding starts
+  size_t begin;     // offset sentences are kept from
+  size_t end;
+  std::vector<GpsFix> fixes;            // fix after each sentence
+  std::vector<unsigned int> sentences;  // its GPS_SENTENCE_* flag
+  std::vector<unsigned int> committed;  // flags of the sentences decoded up to it
+  GpsStats stats;
+};
+
+// chunk decoded by this thread, keeps no sentences during the warmup
+static thread_local Chunk *chunk_current;
+static thread_local bool chunk_keep;
+static thread_local unsigned int chunk_committed;
+
+static void keep_sentence(FarmGPS &, unsigned int sentence, const GpsFix &fix) {
+  if (sentence == GPS_SENTENCE_EPOCH)
+    return;
+  chunk_committed |= sentence;
+  if (chunk_keep) {
+    chunk_current->fixes.push_back(fix);
+    chunk_current->sentences.push_back(sentence);
+    chunk_current->committed.push_back(chunk_committed);
+  }
+}
+
+// GpsStats holds unsigned long counters only
+static void add_stats(GpsStats &to, const GpsStats &from, bool subtract = false) {
+  unsigned long *_to = (unsigned long *)&to;
+  const unsigned long *_from = (const unsigned long *)&from;
+  for (size_t i = 0; i < sizeof to / sizeof *_to; i++)
+    _to[i] = subtract ? _to[i] - _from[i] : _to[i] + _from[i];
+}
+
+static void decode_chunk(const char *data, GpsConfig *config, Chunk *chunk) {
+  FarmGPS gps(*config);
+
+  chunk_current = chunk;
+  chunk_committed = 0;
+  chunk_keep = false;
+  gps.decode_buffer(data + chunk->warmup, chunk->begin - chunk->warmup);
+  GpsStats _warmup;
+  gps.stats(_warmup);
+
+  chunk_keep = true;
+  gps.decode_buffer(data + chunk->begin, chunk->end - chunk->begin);
+  chunk_keep = false;
+  gps.stats(chunk->stats);
+  add_stats(chunk->stats, _warmup, true);
+}
+
+//------
+// carry
+//------
+
+// The decoder of a chunk starts without a fix. A field it has not written yet
+// takes its value after the sentence before in the log: fields of sentences it
+// did not decode, and fields still at their initial value, as an empty term
+// keeps the value of a field. Integer fields have no free initial value, they
+// follow the sentences only.
+#define LOG_WRITTEN(field, writers) \
+  if (!(committed & (writers))) fix.field = before.field
+#define LOG_DECODED(field, writers) \
+  if (!(committed & (writers)) || fix.field == initial.field) fix.field = before.field
+
+// GPS_SENTENCE_* flag when the configuration parses the fields of the sentence
+#define LOG_WRITER(sentence, fields) ((interest & (fields)) ? (sentence) : 0)
+
+static void carry_fix(GpsFix &fix, unsigned int committed, const GpsFix &before,
+  const GpsFix &initial, unsigned int interest) {
+#ifdef GPRMC_TERM
+  const unsigned int rmc_time = LOG_WRITER(GPS_SENTENCE_RMC, GPS_RMC_TIME);
+  const unsigned int rmc_position = LOG_WRITER(GPS_SENTENCE_RMC, GPS_RMC_POSITION);
+  const unsigned int rmc_motion = LOG_WRITER(GPS_SENTENCE_RMC, GPS_RMC_MOTION);
+  if (!(committed & rmc_time) || !fix.date.day)
+    fix.date = before.date;
+  LOG_WRITTEN(last_RMC_fix, GPS_SENTENCE_RMC);
+#else
+  const unsigned int rmc_time = 0, rmc_position = 0, rmc_motion = 0;
+#endif
+  LOG_DECODED(time, LOG_WRITER(GPS_SENTENCE_GGA, GPS_GGA_TIME) | rmc_time);
+  LOG_DECODED(latitude, LOG_WRITER(GPS_SENTENCE_GGA, GPS_GGA_POSITION) | rmc_position);
+  LOG_DECODED(longitude, LOG_WRITER(GPS_SENTENCE_GGA, GPS_GGA_POSITION) | rmc_position);
+  LOG_DECODED(altitude, LOG_WRITER(GPS_SENTENCE_GGA, GPS_GGA_ALTITUDE));
+  LOG_WRITTEN(quality, LOG_WRITER(GPS_SENTENCE_GGA, GPS_GGA_QUALITY));
+  LOG_DECODED(speed, LOG_WRITER(GPS_SENTENCE_VTG, GPS_VTG_SPEED) | rmc_motion);
+  LOG_DECODED(course, LOG_WRITER(GPS_SENTENCE_VTG, GPS_VTG_COURSE) | rmc_motion);
+  LOG_DECODED(xte, LOG_WRITER(GPS_SENTENCE_XTE, GPS_XTE_DISTANCE));
+  LOG_WRITTEN(last_GGA_fix, GPS_SENTENCE_GGA | rmc_position);
+  LOG_WRITTEN(last_VTG_fix, GPS_SENTENCE_VTG | rmc_motion);
+  LOG_WRITTEN(last_XTE_fix, GPS_SENTENCE_XTE);
+#ifdef GPGST_TERM
+  const unsigned int gst = LOG_WRITER(GPS_SENTENCE_GST, GPS_GST_ACCURACY);
+  LOG_DECODED(rms, gst);
+  LOG_DECODED(latitude_error, gst);
+  LOG_DECODED(longitude_error, gst);
+  LOG_DECODED(altitude_error, gst);
+  LOG_WRITTEN(last_GST_fix, GPS_SENTENCE_GST);
+#endif
+#ifdef GPHDT_TERM
+  LOG_DECODED(heading, LOG_WRITER(GPS_SENTENCE_HDT, GPS_HDT_HEADING));
+  LOG_WRITTEN(last_HDT_fix, GPS_SENTENCE_HDT);
+#endif
+#ifdef PTNL_PJK_TERM
+  const unsigned int pjk = LOG_WRITER(GPS_SENTENCE_PJK, GPS_PJK_POSITION);
+  LOG_DECODED(northing, pjk);
+  LOG_DECODED(easting, pjk);
+  LOG_DECODED(grid_height, pjk);
+  LOG_WRITTEN(grid_quality, pjk);
+  LOG_WRITTEN(last_PJK_fix, GPS_SENTENCE_PJK);
+#endif
+}
+
+// Commit stamp of a sentence, the epoch is stamped with that of its last sentence
+static unsigned long sentence_stamp(const GpsFix &fix, unsigned int sentence) {
+  switch (sentence) {
+  case GPS_SENTENCE_VTG:
+    return fix.last_VTG_fix;
+  case GPS_SENTENCE_XTE:
+    return fix.last_XTE_fix;
+#ifdef GPGST_TERM
+  case GPS_SENTENCE_GST:
+    return fix.last_GST_fix;
+#endif
+#ifdef GPRMC_TERM
+  case GPS_SENTENCE_RMC:
+    return fix.last_RMC_fix;
+#endif
+#ifdef GPHDT_TERM
+  case GPS_SENTENCE_HDT:
+    return fix.last_HDT_fix;
+#endif
+#ifdef PTNL_PJK_TERM
+  case GPS_SENTENCE_PJK:
+    return fix.last_PJK_fix;
+#endif
+  default:
+    return fix.last_GGA_fix;
+  }
+}
+
+//-------------------------------
+//public functions implementation
+//-------------------------------
+
+void decode_log(const char *data, size_t length, unsigned int threads,
+  const GpsConfig &config, std::vector<GpsFix> &outfixes, GpsStats *outstats) {
+  if (threads < 1)
+    threads = 1;
+  if (threads > length / LOG_MIN_CHUNK + 1)
+    threads = length / LOG_MIN_CHUNK + 1;
+
+  // shared by the decoders, only read while decoding
+  GpsConfig _config = config;
+  _config.callback = keep_sentence;
+  _config.forward = 0;
+
+  std::vector<Chunk> chunks(threads);
+  size_t _begin = 0;
+  for (unsigned int i = 0; i < threads; i++) {
+    Chunk &_c = chunks[i];
+    _c.begin = _begin;
+    _c.end = i + 1 == threads ? length : next_boundary(data, length, length / threads * (i + 1));
+    if (_c.end < _c.begin)
+      _c.end = _c.begin;
+    _c.warmup = _c.begin > LOG_WARMUP ? next_boundary(data, _c.begin, _c.begin - LOG_WARMUP) : 0;
+    _begin = _c.end;
+  }
+
+  std::vector<std::thread> workers;
+  for (unsigned int i = 1; i < threads; i++)
+    workers.push_back(std::thread(decode_chunk, data, &_config, &chunks[i]));
+  decode_chunk(data, &_config, &chunks[0]);
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+
+  // epochs in log order like FarmGPS::commit(), a repeated sentence starts
+  // the next epoch
+  GpsFix _initial;
+  FarmGPS(_config).read_fix(_initial);
+  GpsFix _before = _initial;
+  unsigned int _pending = 0;
+  for (unsigned int i = 0; i < threads; i++) {
+    Chunk &_c = chunks[i];
+    for (size_t j = 0; j < _c.fixes.size(); j++) {
+      GpsFix &_fix = _c.fixes[j];
+      unsigned int _sentence = _c.sentences[j];
+      carry_fix(_fix, _c.committed[j], _before, _initial, _config.interest);
+      _fix.last_epoch = _before.last_epoch;
+      _fix.epoch_time = _before.epoch_time;
+
+      if (_pending & _sentence)
+        _pending = 0;
+      bool _complete = (_pending & _config.epoch_sentences) == _config.epoch_sentences;
+      _pending |= _sentence;
+      if (!_complete && (_pending & _config.epoch_sentences) == _config.epoch_sentences) {
+        _fix.last_epoch = sentence_stamp(_fix, _sentence);
+        _fix.epoch_time = _fix.time;
+        outfixes.push_back(_fix);
+      }
+      _before = _fix;
+    }
+    if (outstats)
+      add_stats(*outstats, _c.stats);
+  }
+}
@@ -0,0 +1,49 @@
+/*
+  LogDecoder - parallel decoding of recorded receiver logs with FarmGPS on a host.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef LogDecoder_h
+#define LogDecoder_h
+
+#include "FarmGPS.h"
+
+#include <vector>
+
+#ifdef GPS_NO_STATS
+#error "LogDecoder reports the decoder statistics, build without GPS_NO_STATS"
+#endif
+
+// bytes decoded ahead of a chunk, a frame running into the chunk is dropped
+// like by a decoder reading the whole log
+#define LOG_WARMUP 4096
+
+// smallest chunk handed to a thread
+#define LOG_MIN_CHUNK 65536
+
+// The log is split at sentence starts following a line end, each chunk is
+// decoded by its own FarmGPS starting LOG_WARMUP bytes early. The sentences
+// of the chunks are then assembled into epochs in log order, with the fields
+// a chunk has not decoded yet taken from the chunk before, so the fixes match
+// a single decoder reading the whole log. Logs carry no arrival times, the
+// epoch gap does not apply and millis() of the application stamps the fixes.
+// Appends the fixes of the epochs completed by the sentences of config, in log
+// order, and adds the statistics of the log to *outstats when given.
+void decode_log(const char *data, size_t length, unsigned int threads,
+  const GpsConfig &config, std::vector<GpsFix> &outfixes, GpsStats *outstats = 0);
+
+#endif
@@ -0,0 +1,167 @@
+/*
+  logdecode - decodes recorded receiver logs to a CSV of fixes on a host.
+Copyright (C) 2011-2013 J.A. Woltjer.
+All rights reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Build from this directory (POSIX):
+//   g++ -O2 -pthread -I../.. ../../FarmGPS.cpp ../../GeoReference.cpp ../../FixLog.cpp LogDecoder.cpp logdecode.cpp -o logdecode
+// Usage:
+//   logdecode [-j threads] [-e epoch sentences] [-o fixes.csv] [-c fixes.fxl] log
+// Writes a row per completed epoch, by default GGA and VTG; -e takes the
+// GPS_SENTENCE_* flags in hex, e.g. -e 1 for logs with GGA only.
+// -c writes the fixes as a FixLog file instead of CSV.
+
+#include "LogDecoder.h"
+#include "FixLog.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//-------------------------
+// clock for the host build
+//-------------------------
+
+// a log has no arrival times
+unsigned long micros() {
+  return 0;
+}
+
+unsigned long millis() {
+  return 0;
+}
+
+//-------
+// output
+//-------
+
+static void write_csv(FILE *out, const std::vector<GpsFix> &fixes) {
+  fprintf(out, "date,time,latitude,longitude,altitude,quality,speed,course,xte\n");
+  for (size_t i = 0; i < fixes.size(); i++) {
+    const GpsFix &f = fixes[i];
+    if (f.date.day)
+      fprintf(out, "%d-%02d-%02d,", f.date.year + (f.date.year > 80 ? 1900 : 2000), f.date.month, f.date.day);
+    else
+      fprintf(out, ",");
+    if (f.time != GPS_INVALID_LONG)
+      fprintf(out, "%02lu:%02lu:%02lu.%02lu,", f.time / 360000, f.time / 6000 % 60,
+        f.time / 100 % 60, f.time % 100);
+    else
+      fprintf(out, ",");
+    if (f.latitude != GPS_INVALID_ANGLE)
+      fprintf(out, "%.7f,%.7f,", f.latitude / 1e7, f.longitude / 1e7);
+    else
+      fprintf(out, ",,");
+    fprintf(out, f.altitude == GPS_INVALID_FLOAT ? "," : "%.3f,", f.altitude);
+    fprintf(out, "%d,", f.quality);
+    fprintf(out, f.speed == GPS_INVALID_FLOAT ? "," : "%.3f,", f.speed);
+    fprintf(out, f.course == GPS_INVALID_FLOAT ? "," : "%.2f,", f.course);
+    fprintf(out, f.xte == GPS_INVALID_FLOAT ? "\n" : "%.2f\n", f.xte);
+  }
+}
+
+static void write_file(const byte *data, unsigned int length, void *file) {
+  fwrite(data, 1, length, (FILE *)file);
+}
+
+static bool write_fix_log(const char *path, const std::vector<GpsFix> &fixes) {
+  FILE *out = fopen(path, "wb");
+  if (!out)
+    return false;
+  static byte buffer[16384];
+  FixLogWriter writer(buffer, sizeof buffer, write_file, out);
+  for (size_t i = 0; i < fixes.size(); i++)
+    writer.add(fixes[i]);
+  writer.close();
+  return fclose(out) == 0;
+}
+
+int main(int argc, char **argv) {
+  unsigned int threads = std::thread::hardware_concurrency();
+  GpsConfig config = GPS_DEFAULT_CONFIG;
+  const char *output = 0;
+  const char *columnar = 0;
+  const char *log = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-e") && i + 1 < argc)
+      config.epoch_sentences = strtoul(argv[++i], 0, 16);
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      output = argv[++i];
+    else if (!strcmp(argv[i], "-c") && i + 1 < argc)
+      columnar = argv[++i];
+    else
+      log = argv[i];
+  }
+  if (!log) {
+    fprintf(stderr, "usage: logdecode [-j threads] [-e epoch sentences] [-o fixes.csv] [-c fixes.fxl] log\n");
+    return 1;
+  }
+
+  int fd = open(log, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) < 0) {
+    fprintf(stderr, "cannot read %s\n", log);
+    return 1;
+  }
+  size_t length = st.st_size;
+  const char *data = length ? (const char *)mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "cannot map %s\n", log);
+    return 1;
+  }
+  if (length)
+    madvise((void *)data, length, MADV_SEQUENTIAL);
+
+  std::vector<GpsFix> fixes;
+  GpsStats stats;
+  memset(&stats, 0, sizeof stats);
+  decode_log(data, length, threads, config, fixes, &stats);
+  if (length)
+    munmap((void *)data, length);
+  close(fd);
+
+  if (columnar) {
+    if (!write_fix_log(columnar, fixes)) {
+      fprintf(stderr, "cannot write %s\n", columnar);
+      return 1;
+    }
+  }
+  else {
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+      fprintf(stderr, "cannot write %s\n", output);
+      return 1;
+    }
+    write_csv(out, fixes);
+    if (output)
+      fclose(out);
+  }
+
+  fprintf(stderr, "%lu fixes, %lu sentences, %lu failed checksum, %lu failed Trimble, %lu unknown, %lu aborted\n",
+    (unsigned long)fixes.size(), stats.good_sentences, stats.failed_checksum, stats.failed_trimble,
+    stats.unknown_sentences, stats.aborted_sentences);
+  return 0;
+}